@@ -22,8 +22,8 @@
 #include "common.h"
 #include "shapes.h"
 #include "handle.h"
-#include "settings.h"
-#include "tcos.h"
+#include "bbox.h"
+#include "shadow.h"
 
 enum {
     /*            EDGE_R
@@ -44,12 +44,6 @@ enum {
     HANDLE_NR
 };
 
-static int beg_x = 0, beg_y = 0;
-static int orig_x = 0, orig_y = 0, orig_w = 0, orig_h = 0;
-static int orig_edge_l_x = 0, orig_edge_l_y = 0, orig_edge_r_x = 0, orig_edge_r_y = 0;
-static int orig_step_x = 0, orig_step_y = 0;
-static int dragging_handle = -1;
-
 static void make_handle_geoms(struct parts_t *p, struct handle_t *bufp)
 {
     struct handle_t *bp = bufp;
@@ -102,39 +96,15 @@ static void make_handle_geoms(struct parts_t *p, struct handle_t *bufp)
     handle_calc_geom(bufp, HANDLE_NR);
 }
 
-void arrow_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
-{
-    struct handle_t handles[HANDLE_NR];
-    make_handle_geoms(parts, handles);
-    
-#define DIFF 4.0
-
-    for (int i = 0; i < TCOS_NR; i++) {
-	int dx = DIFF * tcos(i) + DIFF / 2;
-	int dy = DIFF * tsin(i) + DIFF / 2;
-	cairo_save(cr);
-	cairo_set_source_rgba(cr, 0.0, 0.0, 0.0, 0.05);
-
-	cairo_set_line_width(cr, 1.0);
-	cairo_move_to(cr, handles[HANDLE_POINT].cx + dx, handles[HANDLE_POINT].cy + dy);
-	cairo_line_to(cr, handles[HANDLE_EDGE_L].cx + dx, handles[HANDLE_EDGE_L].cy + dy);
-	cairo_line_to(cr, handles[HANDLE_EDGE_R].cx + dx, handles[HANDLE_EDGE_R].cy + dy);
-	cairo_close_path(cr);
-	cairo_fill(cr);
-    
-	cairo_set_line_width(cr, parts->thickness);
-	cairo_move_to(cr, handles[HANDLE_STEP].cx + dx, handles[HANDLE_STEP].cy + dy);
-	cairo_line_to(cr, handles[HANDLE_GRIP].cx + dx, handles[HANDLE_GRIP].cy + dy);
-	cairo_stroke(cr);
-
-	cairo_restore(cr);
-    }
-
-#undef DIFF
-
-
+struct shape_t {
+    struct handle_t *handles;
+    double thickness;
+};
 
-    cairo_set_source_rgba(cr, parts->fg.red, parts->fg.green, parts->fg.blue, 1);
+static void paint_shape(cairo_t *cr, void *data)
+{
+    struct shape_t *shape = data;
+    struct handle_t *handles = shape->handles;
     
     cairo_set_line_width(cr, 1.0);
     cairo_move_to(cr, handles[HANDLE_POINT].cx, handles[HANDLE_POINT].cy);
@@ -143,12 +113,43 @@ void arrow_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
     cairo_close_path(cr);
     cairo_fill(cr);
     
-    cairo_set_line_width(cr, parts->thickness);
+    cairo_set_line_width(cr, shape->thickness);
     cairo_move_to(cr, handles[HANDLE_STEP].cx, handles[HANDLE_STEP].cy);
     cairo_line_to(cr, handles[HANDLE_GRIP].cx, handles[HANDLE_GRIP].cy);
     cairo_stroke(cr);
 }
 
+/* the area the arrow itself covers. */
+static void get_shape_bbox(struct parts_t *parts, struct handle_t *handles, cairo_rectangle_int_t *rect)
+{
+    double x1 = parts->x, y1 = parts->y, x2 = parts->x, y2 = parts->y;
+    for (int i = 0; i < HANDLE_NR; i++) {
+	if (!isfinite(handles[i].cx) || !isfinite(handles[i].cy))
+	    continue;	/* no direction yet. */
+	x1 = MIN(x1, handles[i].cx);
+	y1 = MIN(y1, handles[i].cy);
+	x2 = MAX(x2, handles[i].cx);
+	y2 = MAX(y2, handles[i].cy);
+    }
+    bbox_from_corners(rect, floor(x1), floor(y1), ceil(x2), ceil(y2));
+    /* the line sticks out by half of its width. */
+    bbox_inflate(rect, (parts->thickness + 1) / 2 + 1);
+}
+
+void arrow_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected)
+{
+    struct handle_t handles[HANDLE_NR];
+    make_handle_geoms(parts, handles);
+    
+    struct shape_t shape = { handles, parts->thickness };
+    cairo_rectangle_int_t extent;
+    get_shape_bbox(parts, handles, &extent);
+    shadow_draw(cr, &shadow_default, &extent, paint_shape, &shape);
+    
+    cairo_set_source_rgba(cr, parts->fg.red, parts->fg.green, parts->fg.blue, 1);
+    paint_shape(cr, &shape);
+}
+
 void arrow_draw_handle(struct parts_t *parts, cairo_t *cr)
 {
     struct handle_t handles[HANDLE_NR];
@@ -215,77 +216,77 @@ static gboolean on_triangle(struct handle_t *handles, int x, int y)
     return FALSE;
 }
 
-gboolean arrow_select(struct parts_t *parts, int x, int y, gboolean selected)
+gboolean arrow_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected)
 {
     struct handle_t handles[HANDLE_NR];
     make_handle_geoms(parts, handles);
     
-    beg_x = x;
-    beg_y = y;
-    orig_x = parts->x;
-    orig_y = parts->y;
-    orig_w = parts->width;
-    orig_h = parts->height;
-    orig_edge_l_x = handles[HANDLE_EDGE_L].x;
-    orig_edge_l_y = handles[HANDLE_EDGE_L].y;
-    orig_edge_r_x = handles[HANDLE_EDGE_R].x;
-    orig_edge_r_y = handles[HANDLE_EDGE_R].y;
-    orig_step_x = handles[HANDLE_STEP].x;
-    orig_step_y = handles[HANDLE_STEP].y;
+    drag->beg_x = x;
+    drag->beg_y = y;
+    drag->orig_x = parts->x;
+    drag->orig_y = parts->y;
+    drag->orig_w = parts->width;
+    drag->orig_h = parts->height;
+    drag->orig_edge_l_x = handles[HANDLE_EDGE_L].x;
+    drag->orig_edge_l_y = handles[HANDLE_EDGE_L].y;
+    drag->orig_edge_r_x = handles[HANDLE_EDGE_R].x;
+    drag->orig_edge_r_y = handles[HANDLE_EDGE_R].y;
+    drag->orig_step_x = handles[HANDLE_STEP].x;
+    drag->orig_step_y = handles[HANDLE_STEP].y;
     
     if (selected) {
-	dragging_handle = on_handle(handles, x, y);
-	if (dragging_handle >= 0)
+	drag->handle = on_handle(handles, x, y);
+	if (drag->handle >= 0)
 	    return TRUE;
     }
     
-    dragging_handle = -1;
+    drag->handle = -1;
     return on_line(parts, handles, x, y) || on_triangle(handles, x, y);
 }
 
-void arrow_drag_step(struct parts_t *p, int x, int y)
+void arrow_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y)
 {
     struct handle_t handles[HANDLE_NR];
     make_handle_geoms(p, handles);
     
-    int dx = x - beg_x;
-    int dy = y - beg_y;
+    int dx = x - drag->beg_x;
+    int dy = y - drag->beg_y;
     
     double new_x, new_y;
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case -1:
-	p->x = orig_x + dx;
-	p->y = orig_y + dy;
+	p->x = drag->orig_x + dx;
+	p->y = drag->orig_y + dy;
 	break;
 	
     case HANDLE_GRIP:
-	p->x = orig_x + dx;
-	p->y = orig_y + dy;
-	p->width = orig_w - dx;
-	p->height = orig_h - dy;
+	p->x = drag->orig_x + dx;
+	p->y = drag->orig_y + dy;
+	p->width = drag->orig_w - dx;
+	p->height = drag->orig_h - dy;
 	break;
 	
     case HANDLE_POINT:
-	p->width = orig_w + dx;
-	p->height = orig_h + dy;
+	p->width = drag->orig_w + dx;
+	p->height = drag->orig_h + dy;
 	break;
 
     case HANDLE_STEP:
     case HANDLE_EDGE_L:
     case HANDLE_EDGE_R:
 	if (TRUE) {
-	    switch (dragging_handle) {
+	    switch (drag->handle) {
 	    case HANDLE_EDGE_L:
-		new_x = orig_edge_l_x + dx;
-		new_y = orig_edge_l_y + dy;
+		new_x = drag->orig_edge_l_x + dx;
+		new_y = drag->orig_edge_l_y + dy;
 		break;
 	    case HANDLE_EDGE_R:
-		new_x = orig_edge_r_x + dx;
-		new_y = orig_edge_r_y + dy;
+		new_x = drag->orig_edge_r_x + dx;
+		new_y = drag->orig_edge_r_y + dy;
 		break;
 	    case HANDLE_STEP:
-		new_x = orig_step_x + dx;
-		new_y = orig_step_y + dy;
+		new_x = drag->orig_step_x + dx;
+		new_y = drag->orig_step_y + dy;
 		break;
 	    }
 	    double cx = handles[HANDLE_GRIP].x - handles[HANDLE_POINT].x;
@@ -295,7 +296,7 @@ void arrow_drag_step(struct parts_t *p, int x, int y)
 	    double clen = sqrt(cx * cx + cy * cy);
 	    double alen = sqrt(ax * ax + ay * ay);
 	    double theta = acos((ax * cx + ay * cy) / clen / alen);
-	    switch (dragging_handle) {
+	    switch (drag->handle) {
 	    case HANDLE_EDGE_L:
 	    case HANDLE_EDGE_R:
 		p->theta = theta;
@@ -310,13 +311,21 @@ void arrow_drag_step(struct parts_t *p, int x, int y)
     }
 }
 
-void arrow_drag_fini(struct parts_t *parts, int x, int y)
+void arrow_drag_fini(struct parts_t *parts, struct drag_t *drag, int x, int y)
+{
+}
+
+void arrow_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect)
 {
+    struct handle_t handles[HANDLE_NR];
+    make_handle_geoms(parts, handles);
+    get_shape_bbox(parts, handles, rect);
+    bbox_inflate(rect, shadow_extent(&shadow_default));
 }
 
-struct parts_t *arrow_create(int x, int y)
+struct parts_t *arrow_create(struct render_ctx_t *ctx, int x, int y)
 {
-    struct parts_t *p = parts_alloc();
+    struct parts_t *p = parts_alloc(ctx);
     
     p->type = PARTS_ARROW;
     p->x = x;
@@ -0,0 +1,291 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <gtk/gtk.h>
+
+#include "common.h"
+#include "main.h"
+#include "shapes.h"
+#include "png.h"
+#include "batch.h"
+
+/* batch mode annotates images without the window.
+ *
+ * the annotations are described in a key file, where each group is a part,
+ * drawn in the order of the groups:
+ *
+ *   [email]
+ *   type=mask
+ *   x=120
+ *   y=40
+ *   width=300
+ *   height=24
+ *
+ *   [note]
+ *   type=text
+ *   x=400
+ *   y=200
+ *   text=This button is broken.
+ *   color=#ff0000
+ *   font=Sans Bold 24
+ *
+ * type is one of arrow, text, rect and mask. the other keys are those of
+ * struct parts_t, and are optional. an arrow points at (x + width, y + height)
+ * from (x, y). the defaults are those of the window.
+ *
+ * the images are done in parallel, one per thread. each is exported as PNG
+ * to the output directory, with the name of the input and suffix .png.
+ */
+
+static const char *type_names[PARTS_NR] = {
+    [PARTS_ARROW] = "arrow",
+    [PARTS_TEXT] = "text",
+    [PARTS_RECT] = "rect",
+    [PARTS_MASK] = "mask",
+};
+
+static int get_int(GKeyFile *kf, const char *group, const char *key, int def)
+{
+    GError *err = NULL;
+    
+    if (!g_key_file_has_key(kf, group, key, NULL))
+	return def;
+    int val = g_key_file_get_integer(kf, group, key, &err);
+    if (err != NULL) {
+	fprintf(stderr, "[%s] %s: %s\n", group, key, err->message);
+	exit(1);
+    }
+    return val;
+}
+
+static double get_double(GKeyFile *kf, const char *group, const char *key, double def)
+{
+    GError *err = NULL;
+    
+    if (!g_key_file_has_key(kf, group, key, NULL))
+	return def;
+    double val = g_key_file_get_double(kf, group, key, &err);
+    if (err != NULL) {
+	fprintf(stderr, "[%s] %s: %s\n", group, key, err->message);
+	exit(1);
+    }
+    return val;
+}
+
+static struct parts_t *read_parts(struct render_ctx_t *ctx, GKeyFile *kf, const char *group)
+{
+    char *type = g_key_file_get_string(kf, group, "type", NULL);
+    if (type == NULL) {
+	fprintf(stderr, "[%s] type: missing.\n", group);
+	exit(1);
+    }
+    
+    int x = get_int(kf, group, "x", 0);
+    int y = get_int(kf, group, "y", 0);
+    struct parts_t *p = NULL;
+    if (strcmp(type, type_names[PARTS_ARROW]) == 0) {
+	p = arrow_create(ctx, x, y);
+	p->triangle_len = get_int(kf, group, "triangle_len", p->triangle_len);
+	p->theta = get_double(kf, group, "theta", p->theta);
+    } else if (strcmp(type, type_names[PARTS_TEXT]) == 0)
+	p = text_create(ctx, x, y);
+    else if (strcmp(type, type_names[PARTS_RECT]) == 0)
+	p = rect_create(ctx, x, y);
+    else if (strcmp(type, type_names[PARTS_MASK]) == 0)
+	p = mask_create(ctx, x, y);
+    else {
+	fprintf(stderr, "[%s] type: unknown type: %s\n", group, type);
+	exit(1);
+    }
+    g_free(type);
+    
+    p->width = get_int(kf, group, "width", p->width);
+    p->height = get_int(kf, group, "height", p->height);
+    p->thickness = get_int(kf, group, "thickness", p->thickness);
+    
+    char *color = g_key_file_get_string(kf, group, "color", NULL);
+    if (color != NULL) {
+	if (!gdk_rgba_parse(&p->fg, color)) {
+	    fprintf(stderr, "[%s] color: bad color: %s\n", group, color);
+	    exit(1);
+	}
+	g_free(color);
+    }
+    
+    char *font = g_key_file_get_string(kf, group, "font", NULL);
+    if (font != NULL) {
+	p->fontname = g_intern_string(font);
+	g_free(font);
+    }
+    
+    char *text = g_key_file_get_string(kf, group, "text", NULL);
+    if (text != NULL) {
+	g_free(p->text);
+	p->text = text;
+    }
+    
+    return p;
+}
+
+/* reads the annotations into a history with an empty base.
+ * the text is laid out with ctx here, on the main thread.
+ */
+static struct history_t *read_desc(struct render_ctx_t *ctx, const char *desc)
+{
+    GError *err = NULL;
+    GKeyFile *kf = g_key_file_new();
+    
+    if (!g_key_file_load_from_file(kf, desc, G_KEY_FILE_NONE, &err)) {
+	fprintf(stderr, "%s: %s\n", desc, err->message);
+	exit(1);
+    }
+    
+    struct history_t *hp = g_new0(struct history_t, 1);
+    struct parts_t *base = parts_alloc(ctx);
+    base->type = PARTS_BASE;
+    hp->ctx = ctx;
+    history_append_parts(hp, base);
+    
+    char **groups = g_key_file_get_groups(kf, NULL);
+    for (char **gp = groups; *gp != NULL; gp++) {
+	struct parts_t *p = read_parts(ctx, kf, *gp);
+	history_append_parts(hp, p);
+	/* text uses pango, which has to be done here. the parts are
+	 * shared by the histories of all the images.
+	 */
+	call_prepare(ctx, p);
+    }
+    g_strfreev(groups);
+    g_key_file_free(kf);
+    
+    return hp;
+}
+
+struct job_t {
+    struct history_t *hp;
+    char *input, *output;
+};
+
+static gint failed = FALSE;
+
+static void run_job(gpointer data, gpointer user_data)
+{
+    struct job_t *job = data;
+    GError *err = NULL;
+    
+    GdkPixbuf *pixbuf = gdk_pixbuf_new_from_file(job->input, &err);
+    if (pixbuf == NULL) {
+	fprintf(stderr, "%s\n", err->message);
+	g_error_free(err);
+	g_atomic_int_set(&failed, TRUE);
+	goto end;
+    }
+    
+    /* the base is the only part of each image's own. */
+    struct parts_t *base = history_writable_parts(job->hp, job->hp->parts[0]);
+    base->width = gdk_pixbuf_get_width(pixbuf);
+    base->height = gdk_pixbuf_get_height(pixbuf);
+    base->surface = gdk_cairo_surface_create_from_pixbuf(pixbuf, 1, NULL);
+    g_object_unref(pixbuf);
+    
+    if (!export_png(job->hp, job->output, PNG_LEVEL_DEFAULT, &err)) {
+	fprintf(stderr, "%s\n", err->message);
+	g_error_free(err);
+	g_atomic_int_set(&failed, TRUE);
+    }
+    
+ end:
+    history_free(job->hp);
+    g_free(job->input);
+    g_free(job->output);
+    g_free(job);
+}
+
+/* the name in outdir, with the suffix replaced by .png. */
+static char *output_name(const char *outdir, const char *input)
+{
+    char *basename = g_path_get_basename(input);
+    char *dot = strrchr(basename, '.');
+    if (dot != NULL && dot != basename)
+	*dot = '\0';
+    char *name = g_strconcat(basename, ".png", NULL);
+    char *output = g_build_filename(outdir, name, NULL);
+    g_free(name);
+    g_free(basename);
+    return output;
+}
+
+/* the same key for the same file, even through links, if it exists. */
+static char *file_key(const char *path)
+{
+    struct stat st;
+    
+    if (stat(path, &st) == 0)
+	return g_strdup_printf("%llu:%llu", (unsigned long long) st.st_dev, (unsigned long long) st.st_ino);
+    return g_canonicalize_filename(path, NULL);
+}
+
+/* returns the exit status. */
+int batch_main(const char *desc, const char *outdir, int nfiles, char **files)
+{
+    GError *err = NULL;
+    struct render_ctx_t *ctx = render_ctx_new();
+    struct history_t *hp = read_desc(ctx, desc);
+    
+    GThreadPool *pool = g_thread_pool_new(run_job, NULL, g_get_num_processors(), TRUE, &err);
+    if (pool == NULL) {
+	fprintf(stderr, "%s\n", err->message);
+	exit(1);
+    }
+    
+    /* the images are written in parallel, so an output must not be
+     * an input, nor another output.
+     */
+    char **outputs = g_new(char *, nfiles);
+    GHashTable *keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (int i = 0; i < nfiles; i++)
+	g_hash_table_add(keys, file_key(files[i]));
+    for (int i = 0; i < nfiles; i++) {
+	outputs[i] = output_name(outdir, files[i]);
+	char *key = file_key(outputs[i]);
+	if (g_hash_table_contains(keys, key)) {
+	    fprintf(stderr, "%s: output would overwrite an input or another output.\n", outputs[i]);
+	    exit(1);
+	}
+	g_hash_table_add(keys, key);
+    }
+    g_hash_table_destroy(keys);
+    
+    for (int i = 0; i < nfiles; i++) {
+	struct job_t *job = g_new0(struct job_t, 1);
+	job->hp = history_dup(hp);
+	job->input = g_strdup(files[i]);
+	job->output = outputs[i];
+	g_thread_pool_push(pool, job, NULL);
+    }
+    g_free(outputs);
+    
+    g_thread_pool_free(pool, FALSE, TRUE);
+    history_free(hp);
+    render_ctx_free(ctx);
+    
+    return failed ? 1 : 0;
+}
@@ -14,14 +14,9 @@
  *    You should have received a copy of the GNU General Public License
  *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
-#include <stdio.h>
-#include <stdint.h>
-#include <math.h>
+#ifndef BATCH_H__INCLUDED
+#define BATCH_H__INCLUDED
 
-#include "tcos.h"
+int batch_main(const char *desc, const char *outdir, int nfiles, char **files);
 
-/* sin table for shadow */
-
-const double tsin_table[TCOS_NR] = {
-#include "tcos.inc"
-};
+#endif	/* ifndef BATCH_H__INCLUDED */
@@ -0,0 +1,83 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BBOX_H__INCLUDED
+#define BBOX_H__INCLUDED
+
+/* bounding boxes in canvas pixels. width or height <= 0 means empty. */
+
+static inline gboolean bbox_is_empty(const cairo_rectangle_int_t *r)
+{
+    return r->width <= 0 || r->height <= 0;
+}
+
+static inline void bbox_set_empty(cairo_rectangle_int_t *r)
+{
+    r->x = r->y = r->width = r->height = 0;
+}
+
+/* corners may be given in any order. */
+static inline void bbox_from_corners(cairo_rectangle_int_t *r, int x1, int y1, int x2, int y2)
+{
+    r->x = MIN(x1, x2);
+    r->y = MIN(y1, y2);
+    r->width = MAX(x1, x2) - r->x;
+    r->height = MAX(y1, y2) - r->y;
+}
+
+/* also gives an area to degenerate boxes, like a zero-width rect. */
+static inline void bbox_inflate(cairo_rectangle_int_t *r, int n)
+{
+    r->x -= n;
+    r->y -= n;
+    r->width += n * 2;
+    r->height += n * 2;
+}
+
+static inline void bbox_union(cairo_rectangle_int_t *r, const cairo_rectangle_int_t *s)
+{
+    if (bbox_is_empty(s))
+	return;
+    if (bbox_is_empty(r)) {
+	*r = *s;
+	return;
+    }
+    int x2 = MAX(r->x + r->width, s->x + s->width);
+    int y2 = MAX(r->y + r->height, s->y + s->height);
+    r->x = MIN(r->x, s->x);
+    r->y = MIN(r->y, s->y);
+    r->width = x2 - r->x;
+    r->height = y2 - r->y;
+}
+
+static inline gboolean bbox_intersects(const cairo_rectangle_int_t *r, const cairo_rectangle_int_t *s)
+{
+    if (bbox_is_empty(r) || bbox_is_empty(s))
+	return FALSE;
+    return r->x < s->x + s->width && s->x < r->x + r->width
+	    && r->y < s->y + s->height && s->y < r->y + r->height;
+}
+
+/* whether r covers all of s. */
+static inline gboolean bbox_contains(const cairo_rectangle_int_t *r, const cairo_rectangle_int_t *s)
+{
+    if (bbox_is_empty(s))
+	return TRUE;
+    return s->x >= r->x && s->x + s->width <= r->x + r->width
+	    && s->y >= r->y && s->y + s->height <= r->y + r->height;
+}
+
+#endif	/* ifndef BBOX_H__INCLUDED */
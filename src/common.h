@@ -21,6 +21,7 @@
 #include <locale.h>
 #include "gettext.h"
 #define _(String) gettext(String)
+#define N_(String) (String)
 
 #define likely(e) __builtin_expect(!!(e), 1)
 #define unlikely(e) __builtin_expect(!!(e), 0)
@@ -35,8 +36,12 @@ enum {
     PARTS_NR
 };
 
+/* parts are shared by the document, its snapshots and the undo
+ * records, and must not be changed while shared.  see
+ * history_writable_parts().
+ */
 struct parts_t {
-    struct parts_t *next, *back;
+    int ref_count;
     
     int type;
     int x, y, width, height;
@@ -44,33 +49,137 @@ struct parts_t {
     int thickness;
     int triangle_len;
     double theta;
-    char *fontname;
+    const char *fontname;	/* interned */
     char *text;
     GdkRGBA fg;
     
-    GdkPixbuf *pixbuf;
+    cairo_surface_t *surface;	/* the image, for PARTS_BASE */
+    struct text_cache_t *text_cache;	/* for PARTS_TEXT */
+};
+
+/* the text being edited, which is drawn with the cursor and the preedit string. */
+struct text_focus_t {
+    struct parts_t *parts;
+    int cursor_pos;		/* in bytes */
+    gchar *preedit_str;
+    PangoAttrList *preedit_attrs;
+    unsigned int preedit_serial;	/* changes whenever preedit changes. */
+};
+
+/* everything rendering needs besides the parts. text is laid out with
+ * its own font map, so a context is used by one thread at a time.
+ */
+struct render_ctx_t {
+    PangoFontMap *font_map;
+    PangoContext *pango;
+    
+    /* for new parts */
+    GdkRGBA color;
+    char *fontname;
+    int thickness;
+    
+    struct text_focus_t focus;
 };
 
 struct history_t {
-    struct history_t *next;
-    struct parts_t *parts_list, *parts_list_end;
+    struct parts_t **parts;	/* from the bottom. parts[0] is the base. */
+    int nparts, size;
+    struct parts_t *selp;
+    struct render_ctx_t *ctx;
+};
+
+/* how a part was before a step. undo and redo exchange it with the
+ * part in the document, so it always holds the state not shown.
+ */
+struct change_t {
+    struct change_t *next;
+    struct parts_t *parts;	/* NULL if it wasn't there */
+    int from, to;		/* where it was and is. -1 if not there */
     struct parts_t *selp;
+    size_t size;		/* the memory it holds, roughly */
+    int kind;			/* CHANGE_* */
+    gint64 time;		/* of the last change merged into it */
+};
+
+/* kinds of changes. a change of the same kind to the same part soon
+ * after the last one is merged into its step. */
+enum {
+    CHANGE_ANY,			/* never merged */
+    CHANGE_COLOR,
+    CHANGE_FONT,
+    CHANGE_THICKNESS,
+};
+
+/* hp が現在の状態で、ひとつしかない。
+ * 操作開始時に、いじる parts を change_t に記録して、undoable の先頭に追加。
+ * parts は記録と共有になるので、いじる前に複製する。
+ * undo したら、undoable の先頭の記録と hp の parts を入れ替えて、記録を redoable の先頭に移動。
+ * redo したら、redoable の先頭の記録と hp の parts を入れ替えて、記録を undoable の先頭に移動。
+ * 操作開始時は redoable を解放。
+ *
+ * 記録は parts ひとつ分なので、文書の大きさによらない。
+ * undoable が undo_budget を超えたら、古い方から捨てる。
+ */
+struct document_t {
+    struct history_t *hp;
+    struct change_t *undoable, *redoable;
+    int undo_steps, redo_steps;
+    size_t undo_bytes;
+    size_t undo_budget;		/* in bytes, 0 for no limit */
 };
 
-extern struct history_t *undoable, *redoable;
+/* where a drag started and what the part looked like then.
+ * each interaction has its own, so parts operations keep no state.
+ */
+struct drag_t {
+    int handle;			/* -1: the whole part */
+    int beg_x, beg_y;
+    int orig_x, orig_y, orig_w, orig_h;
+    int orig_edge_l_x, orig_edge_l_y, orig_edge_r_x, orig_edge_r_y;	/* for PARTS_ARROW */
+    int orig_step_x, orig_step_y;
+};
 
-struct parts_t *parts_alloc(void);
+struct parts_range_t {
+    struct history_t *hp;
+    int beg, end;
+};
+
+struct render_ctx_t *render_ctx_new(void);
+void render_ctx_free(struct render_ctx_t *ctx);
+
+struct parts_t *parts_alloc(struct render_ctx_t *ctx);
 struct parts_t *parts_dup(struct parts_t *orig);
+struct parts_t *parts_ref(struct parts_t *p);
+void parts_unref(struct parts_t *p);
 
-void history_copy_top_of_undoable(void);
+struct history_t *history_dup(struct history_t *orig);
+void history_free(struct history_t *hp);
+int history_index_of(struct history_t *hp, struct parts_t *p);
+void history_insert_parts(struct history_t *hp, struct parts_t *pp, int index);
+struct parts_t *history_remove_parts(struct history_t *hp, int index);
 void history_append_parts(struct history_t *hp, struct parts_t *pp);
+struct parts_t *history_writable_parts(struct history_t *hp, struct parts_t *p);
+
+struct document_t *document_new(struct render_ctx_t *ctx, struct parts_t *base);
+struct parts_t *history_change_parts(struct document_t *doc, struct parts_t *p, int kind);
+void history_move_parts(struct document_t *doc, struct parts_t *p, int index);
+void history_delete_parts(struct document_t *doc, struct parts_t *p);
+void history_add_parts(struct document_t *doc, struct parts_t *p);
+void history_undo(struct document_t *doc);
+void history_redo(struct document_t *doc);
 
-void call_draw(struct parts_t *p, cairo_t *cr, gboolean selected);;
+void call_draw(struct render_ctx_t *ctx, struct parts_t *p, cairo_t *cr, gboolean selected);
 void call_draw_handle(struct parts_t *p, cairo_t *cr);
-gboolean call_select(struct parts_t *p, int x, int y, gboolean selected);
-void call_drag_step(struct parts_t *p, int x, int y);
-void call_drag_fini(struct parts_t *p, int x, int y);
+gboolean call_select(struct parts_t *p, struct drag_t *drag, int x, int y, gboolean selected);
+void call_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y);
+void call_drag_fini(struct parts_t *p, struct drag_t *drag, int x, int y);
+void call_get_bbox(struct parts_t *p, cairo_rectangle_int_t *rect);
+void call_prepare(struct render_ctx_t *ctx, struct parts_t *p);
 
-void prepare_icons(void);
+void draw_parts_range(struct history_t *hp, int beg, int end,
+	cairo_t *cr, gboolean show_selection);
+void draw_parts(struct history_t *hp, cairo_t *cr, gboolean show_selection);
+void paint_range(cairo_t *cr, void *data);
+void paint_history(cairo_t *cr, void *data);
 
 #endif	/* ifndef COMMON_H__INCLUDED */
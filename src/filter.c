@@ -0,0 +1,186 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <gtk/gtk.h>
+
+#include "filter.h"
+
+/* dilates the alpha of src by a disc of the radius, and writes it to dst
+ * as alpha'ed white.  both are CAIRO_FORMAT_ARGB32.
+ *
+ * a disc is a stack of horizontal segments, so each source row is
+ * max-filtered horizontally into all the half widths 0..radius first.
+ * an output row is then the max of the 2 * radius + 1 rows around it,
+ * each taken at the half width of the disc at that height.
+ * the rows are kept in a ring buffer, so it goes through src only once.
+ */
+void filter_dilate_alpha(const unsigned char *src, int src_stride,
+	unsigned char *dst, int dst_stride, int width, int height, int radius)
+{
+    int nr_rows = radius * 2 + 1;
+    int nr_widths = radius + 1;
+    int half_width[radius + 1];
+    for (int k = 0; k <= radius; k++)
+	half_width[k] = sqrt((radius + 0.5) * (radius + 0.5) - k * k);
+    
+    unsigned char *rows = g_malloc(nr_rows * nr_widths * width);
+    unsigned char *acc = g_malloc(width);
+#define HMAX(j, w) (rows + (((j) % nr_rows) * nr_widths + (w)) * width)
+    
+    int next_row = 0;		/* next source row to filter horizontally */
+    for (int y = 0; y < height; y++) {
+	for ( ; next_row < height && next_row <= y + radius; next_row++) {
+	    const uint32_t *sp = (const uint32_t *) (src + src_stride * next_row);
+	    unsigned char *h0 = HMAX(next_row, 0);
+	    for (int x = 0; x < width; x++)
+		h0[x] = sp[x] >> 24;
+	    for (int w = 1; w < nr_widths; w++) {
+		const unsigned char *prev = HMAX(next_row, w - 1);
+		unsigned char *cur = HMAX(next_row, w);
+		for (int x = 0; x < width; x++) {
+		    unsigned char m = prev[x];
+		    if (x > 0 && prev[x - 1] > m)
+			m = prev[x - 1];
+		    if (x + 1 < width && prev[x + 1] > m)
+			m = prev[x + 1];
+		    cur[x] = m;
+		}
+	    }
+	}
+	
+	memset(acc, 0, width);
+	for (int k = -radius; k <= radius; k++) {
+	    int j = y + k;
+	    if (j < 0 || j >= height)
+		continue;
+	    const unsigned char *h = HMAX(j, half_width[k < 0 ? -k : k]);
+	    for (int x = 0; x < width; x++) {
+		if (h[x] > acc[x])
+		    acc[x] = h[x];
+	    }
+	}
+	
+	uint32_t *dp = (uint32_t *) (dst + dst_stride * y);
+	for (int x = 0; x < width; x++) {
+	    uint32_t a = acc[x];
+	    dp[x] = a << 24 | a << 16 | a << 8 | a;
+	}
+    }
+    
+#undef HMAX
+    g_free(acc);
+    g_free(rows);
+}
+
+/* box blur of A8 images.  the sums are divided by multiplying the
+ * reciprocal in 16.16 fixed point, which is exact enough for shadows.
+ */
+static void box_blur_h(unsigned char *data, int stride, int width, int height, int b, unsigned char *tmp)
+{
+    unsigned int d = b * 2 + 1;
+    unsigned int inv = (65536 + d - 1) / d;
+    
+    for (int y = 0; y < height; y++) {
+	unsigned char *row = data + stride * y;
+	memcpy(tmp, row, width);
+	
+	unsigned int sum = 0;
+	for (int x = 0; x < b && x < width; x++)
+	    sum += tmp[x];
+	for (int x = 0; x < width; x++) {
+	    if (x + b < width)
+		sum += tmp[x + b];
+	    if (x - b - 1 >= 0)
+		sum -= tmp[x - b - 1];
+	    unsigned int v = (sum * inv + 32768) >> 16;
+	    row[x] = v > 255 ? 255 : v;
+	}
+    }
+}
+
+static void box_blur_v(unsigned char *data, int stride, int width, int height, int b,
+	unsigned char *copy, unsigned int *sums)
+{
+    unsigned int d = b * 2 + 1;
+    unsigned int inv = (65536 + d - 1) / d;
+    
+    memcpy(copy, data, stride * height);
+    memset(sums, 0, sizeof *sums * width);
+    
+    for (int y = 0; y < b && y < height; y++) {
+	const unsigned char *sp = copy + stride * y;
+	for (int x = 0; x < width; x++)
+	    sums[x] += sp[x];
+    }
+    for (int y = 0; y < height; y++) {
+	if (y + b < height) {
+	    const unsigned char *sp = copy + stride * (y + b);
+	    for (int x = 0; x < width; x++)
+		sums[x] += sp[x];
+	}
+	if (y - b - 1 >= 0) {
+	    const unsigned char *sp = copy + stride * (y - b - 1);
+	    for (int x = 0; x < width; x++)
+		sums[x] -= sp[x];
+	}
+	unsigned char *dp = data + stride * y;
+	for (int x = 0; x < width; x++) {
+	    unsigned int v = (sums[x] * inv + 32768) >> 16;
+	    dp[x] = v > 255 ? 255 : v;
+	}
+    }
+}
+
+static int box_radius(int radius, int passes)
+{
+    return (radius + passes - 1) / passes;
+}
+
+/* how far filter_blur_alpha() spreads a pixel. */
+int filter_blur_reach(int radius, int passes)
+{
+    if (radius <= 0 || passes <= 0)
+	return 0;
+    return box_radius(radius, passes) * passes;
+}
+
+/* blurs a CAIRO_FORMAT_A8 image in place, with the passes of box blur
+ * whose radii add up to the radius.  3 passes are close to gaussian.
+ * outside of the image is taken as transparent.
+ */
+void filter_blur_alpha(unsigned char *data, int stride, int width, int height, int radius, int passes)
+{
+    if (radius <= 0 || passes <= 0 || width <= 0 || height <= 0)
+	return;
+    
+    int b = box_radius(radius, passes);
+    unsigned char *tmp = g_malloc(width);
+    unsigned char *copy = g_malloc(stride * height);
+    unsigned int *sums = g_new(unsigned int, width);
+    
+    for (int i = 0; i < passes; i++) {
+	box_blur_h(data, stride, width, height, b, tmp);
+	box_blur_v(data, stride, width, height, b, copy, sums);
+    }
+    
+    g_free(sums);
+    g_free(copy);
+    g_free(tmp);
+}
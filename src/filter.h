@@ -14,21 +14,12 @@
  *    You should have received a copy of the GNU General Public License
  *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
-#ifndef TCOS_H__INCLUDED
-#define TCOS_H__INCLUDED
+#ifndef FILTER_H__INCLUDED
+#define FILTER_H__INCLUDED
 
-#define TCOS_NR	16
+void filter_dilate_alpha(const unsigned char *src, int src_stride,
+	unsigned char *dst, int dst_stride, int width, int height, int radius);
+void filter_blur_alpha(unsigned char *data, int stride, int width, int height, int radius, int passes);
+int filter_blur_reach(int radius, int passes);
 
-extern const double tsin_table[TCOS_NR];
-
-static inline double tsin(int idx)
-{
-    return tsin_table[idx & (TCOS_NR - 1)];
-}
-
-static inline double tcos(int idx)
-{
-    return tsin(idx + TCOS_NR / 4);
-}
-
-#endif	/* ifndef TCOS_H__INCLUDED */
+#endif	/* ifndef FILTER_H__INCLUDED */
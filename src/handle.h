@@ -17,6 +17,9 @@
 #ifndef HANDLE_H__INCLUDED
 #define HANDLE_H__INCLUDED
 
+/* how far handles stick out of the point they are put on. */
+#define HANDLE_EXTENT	5
+
 struct handle_t {
     double x, y, width, height;
     double cx, cy;
@@ -20,6 +20,7 @@
 #include <gtk/gtk.h>
 
 #include "common.h"
+#include "main.h"
 #include "icons.inc"
 
 void prepare_icons(void)
@@ -16,252 +16,236 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
 #include <gtk/gtk.h>
 
 #include "common.h"
+#include "main.h"
 #include "shapes.h"
 #include "handle.h"
 #include "settings.h"
 #include "state_mgmt.h"
-#include "tcos.h"
+#include "bbox.h"
+#include "png.h"
+#include "render.h"
+#include "batch.h"
 
 static GtkWidget *toplevel;
 
-/* undoable の先頭が現在の状態。
- * 操作開始時に undoable の先頭を deep copy して、undoable の前に追加。
- * 操作中は undoable の先頭をいじる。
- * 操作終了時にはそのまま放置。
- * undo したら、undoable の先頭を redoable の先頭に移動して、画面を再描画。
- * redo したら、redoable の先頭を undoable の先頭に移動して、画面を再描画。
- * 操作開始時は redoable をクリア。
- *
- * ステップ数が少ないことが前提の構造。
- */
-struct history_t *undoable, *redoable;
+struct document_t *doc;
+static struct render_ctx_t *render_ctx;
 
 static GtkWidget *evbox;
 static GtkWidget *drawable;
+static GtkWidget *undo_label;
 
-/**** parts ****/
+static int undo_memory = -1;	/* --undo-memory in MiB, or -1 for the default */
 
-struct parts_t *parts_alloc(void)
-{
-    struct parts_t *p = g_new0(struct parts_t, 1);
-    
-    p->fg = *settings_get_color();
-    p->fontname = settings_get_font();
-    p->thickness = settings_get_thickness();
-    
-    return p;
-}
+/**** damage ****/
 
-struct parts_t *parts_dup(struct parts_t *orig)
-{
-    struct parts_t *p = g_new0(struct parts_t, 1);
-    *p = *orig;
-    p->next = p->back = NULL;
-    if (p->text != NULL)
-	p->text = g_strdup(p->text);
-    if (p->fontname != NULL)
-	p->fontname = g_strdup(p->fontname);
-    // p->pixbuf はそのままでいいかな
-    return p;
-}
+/* area to be redrawn. editing code adds the parts it touches here both
+ * before and after the change, and then flushes it.
+ */
+static cairo_rectangle_int_t damage;
 
-/**** history ****/
+/* the canvas is rendered here, and then copied to the window. */
+static struct render_t *canvas = NULL;
 
-void history_append_parts(struct history_t *hp, struct parts_t *pp)
+void damage_add_parts(struct parts_t *p)
 {
-    if (hp->parts_list != NULL) {
-	pp->back = hp->parts_list_end;
-	pp->back->next = pp;
-    } else
-	hp->parts_list = pp;
-    hp->parts_list_end = pp;
-}
-
-static void history_insert_parts_after(struct history_t *hp, struct parts_t *pp, struct parts_t *after)
-{
-    pp->back = after;
-    pp->next = after->next;
+    if (p == NULL || p->type == PARTS_BASE)
+	return;		/* the base never changes. */
     
-    if (after->next != NULL)
-	after->next->back = pp;
-    else
-	hp->parts_list_end = pp;
-    after->next = pp;
+    cairo_rectangle_int_t rect;
+    call_prepare(render_ctx, p);
+    call_get_bbox(p, &rect);
+    bbox_inflate(&rect, HANDLE_EXTENT);
+    bbox_union(&damage, &rect);
 }
 
-static void history_unlink_parts(struct history_t *hp, struct parts_t *parts)
+/* masks are made from the pixels under them, so draw a mask entirely
+ * once any of it is in the area.
+ */
+static void grow_for_masks(struct history_t *hp, cairo_rectangle_int_t *area)
 {
-    if (parts->back == NULL)
-	hp->parts_list = parts->next;
-    else
-	parts->back->next = parts->next;
-    
-    if (parts->next == NULL)
-	hp->parts_list_end = parts->back;
-    else
-	parts->next->back = parts->back;
-    
-    parts->back = parts->next = NULL;
-    
-    if (hp->selp == parts)
-	hp->selp = NULL;
+    gboolean grown;
+    do {
+	grown = FALSE;
+	for (int i = 0; i < hp->nparts; i++) {
+	    struct parts_t *p = hp->parts[i];
+	    if (p->type != PARTS_MASK)
+		continue;
+	    cairo_rectangle_int_t rect;
+	    call_get_bbox(p, &rect);
+	    if (bbox_intersects(area, &rect) && !bbox_contains(area, &rect)) {
+		bbox_union(area, &rect);
+		grown = TRUE;
+	    }
+	}
+    } while (grown);
 }
 
-static struct history_t *history_dup(struct history_t *orig)
+void damage_flush(void)
 {
-    struct history_t *hp = g_new0(struct history_t, 1);
+    if (bbox_is_empty(&damage))
+	return;
     
-    for (struct parts_t *op = orig->parts_list; op != NULL; op = op->next) {
-	struct parts_t *pp = parts_dup(op);
-	history_append_parts(hp, pp);
-	if (orig->selp == op)
-	    hp->selp = pp;
-    }
+    grow_for_masks(doc->hp, &damage);
     
-    return hp;
+    if (canvas != NULL)
+	render_invalidate(canvas, &damage);
+    gtk_widget_queue_draw_area(drawable, damage.x, damage.y, damage.width, damage.height);
+    bbox_set_empty(&damage);
 }
 
-void history_copy_top_of_undoable(void)
+void damage_all(void)
 {
-    struct history_t *hp = history_dup(undoable);
-    hp->next = undoable;
-    undoable = hp;
-    
-    redoable = NULL;	/* leaks a little */
+    bbox_set_empty(&damage);
+    if (canvas != NULL)
+	render_invalidate(canvas, NULL);
+    gtk_widget_queue_draw(drawable);
 }
 
-static void history_undo(void)
+/**** layer cache ****/
+
+/* while a part is dragged, the parts below it and those above it don't
+ * change, so they are flattened into two layers once.
+ * the parts above can't be flattened if there is a mask among them,
+ * since it depends on the dragged part.
+ */
+static struct {
+    int index;			/* of the dragged part */
+    cairo_surface_t *below, *above;	/* above is NULL if not cached. */
+} layer;
+
+void layer_cache_build(int index)
 {
-    struct history_t *hp = undoable;
-    if (hp->next == NULL) {
-	/* can't undo */
-	return;
+    struct history_t *hp = doc->hp;
+    struct parts_t *base = hp->parts[0];
+    
+    layer_cache_drop();
+    
+    for (int i = 0; i < hp->nparts; i++)
+	call_prepare(render_ctx, hp->parts[i]);
+    
+    struct parts_range_t range = { hp, 0, index };
+    layer.below = cairo_image_surface_create(CAIRO_FORMAT_RGB24, base->width, base->height);
+    render_all(layer.below, hp, paint_range, &range);
+    
+    gboolean mask_above = FALSE;
+    for (int i = index + 1; i < hp->nparts; i++) {
+	if (hp->parts[i]->type == PARTS_MASK)
+	    mask_above = TRUE;
+    }
+    if (!mask_above && index + 1 < hp->nparts) {
+	range.beg = index + 1;
+	range.end = hp->nparts;
+	layer.above = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, base->width, base->height);
+	render_all(layer.above, hp, paint_range, &range);
     }
-    undoable = hp->next;
     
-    hp->next = redoable;
-    redoable = hp;
+    layer.index = index;
 }
 
-static void history_redo(void)
+void layer_cache_drop(void)
 {
-    struct history_t *hp = redoable;
-    if (hp == NULL) {
-	/* can't redo */
-	return;
-    }
-    redoable = hp->next;
-
-    hp->next = undoable;
-    undoable = hp;
+    if (layer.below != NULL)
+	cairo_surface_destroy(layer.below);
+    if (layer.above != NULL)
+	cairo_surface_destroy(layer.above);
+    memset(&layer, 0, sizeof layer);
 }
 
-/****/
-
-static void base_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
+/* the layers are painted from several threads at once, so each paints
+ * through a surface of its own.
+ */
+static void paint_layer(cairo_t *cr, cairo_surface_t *sf, cairo_operator_t op)
 {
-    gdk_cairo_set_source_pixbuf(cr, parts->pixbuf, 0, 0);
+    cairo_surface_t *alias = cairo_image_surface_create_for_data(
+	    cairo_image_surface_get_data(sf), cairo_image_surface_get_format(sf),
+	    cairo_image_surface_get_width(sf), cairo_image_surface_get_height(sf),
+	    cairo_image_surface_get_stride(sf));
+    
+    cairo_save(cr);
+    cairo_set_operator(cr, op);
+    cairo_set_source_surface(cr, alias, 0, 0);
     cairo_paint(cr);
+    cairo_restore(cr);
+    
+    cairo_surface_destroy(alias);
 }
 
-static gboolean base_select(struct parts_t *parts, int x, int y, gboolean selected)
+/* draws hp with the layers, if there are. */
+static gboolean draw_layers(struct history_t *hp, cairo_t *cr)
 {
+    if (layer.below == NULL)
+	return FALSE;
+    
+    paint_layer(cr, layer.below, CAIRO_OPERATOR_SOURCE);
+    
+    draw_parts_range(hp, layer.index, layer.index + 1, cr, TRUE);
+    
+    if (layer.above != NULL)
+	paint_layer(cr, layer.above, CAIRO_OPERATOR_OVER);
+    else
+	draw_parts_range(hp, layer.index + 1, hp->nparts, cr, TRUE);
+    
     return TRUE;
 }
 
-/****/
-
-struct {
-    void (*draw)(struct parts_t *parts, cairo_t *cr, gboolean selected);
-    void (*draw_handle)(struct parts_t *parts, cairo_t *cr);
-    gboolean (*select)(struct parts_t *parts, int x, int y, gboolean selected);
-    void (*drag_step)(struct parts_t *parts, int x, int y);
-    void (*drag_fini)(struct parts_t *parts, int x, int y);
-} parts_ops[PARTS_NR] = {
-    { base_draw, NULL, base_select },
-    { arrow_draw, arrow_draw_handle, arrow_select, arrow_drag_step, arrow_drag_fini },
-    { text_draw, text_draw_handle, text_select, text_drag_step, text_drag_fini },
-    { rect_draw, rect_draw_handle, rect_select, rect_drag_step, rect_drag_fini },
-    { mask_draw, mask_draw_handle, mask_select, mask_drag_step, mask_drag_fini },
-};
-
-void call_draw(struct parts_t *p, cairo_t *cr, gboolean selected)
-{
-    if (p->type < 0 || p->type >= PARTS_NR) {
-	fprintf(stderr, "unknown parts type: %d.\n", p->type);
-	exit(1);
-    }
-    if (parts_ops[p->type].draw != NULL)
-	(*parts_ops[p->type].draw)(p, cr, selected);
-}
-
-void call_draw_handle(struct parts_t *p, cairo_t *cr)
+static void paint_canvas(cairo_t *cr, void *data)
 {
-    if (p->type < 0 || p->type >= PARTS_NR) {
-	fprintf(stderr, "unknown parts type: %d.\n", p->type);
-	exit(1);
-    }
-    if (parts_ops[p->type].draw_handle != NULL)
-	(*parts_ops[p->type].draw_handle)(p, cr);
-}
-
-gboolean call_select(struct parts_t *p, int x, int y, gboolean selected)
-{
-    if (p->type < 0 || p->type >= PARTS_NR) {
-	fprintf(stderr, "unknown parts type: %d.\n", p->type);
-	exit(1);
-    }
-    if (parts_ops[p->type].select != NULL)
-	return (*parts_ops[p->type].select)(p, x, y, selected);
-    return FALSE;
-}
-
-void call_drag_step(struct parts_t *p, int x, int y)
-{
-    if (p->type < 0 || p->type >= PARTS_NR) {
-	fprintf(stderr, "unknown parts type: %d.\n", p->type);
-	exit(1);
-    }
-    if (parts_ops[p->type].drag_step != NULL)
-	(*parts_ops[p->type].drag_step)(p, x, y);
-}
-
-void call_drag_fini(struct parts_t *p, int x, int y)
-{
-    if (p->type < 0 || p->type >= PARTS_NR) {
-	fprintf(stderr, "unknown parts type: %d.\n", p->type);
-	exit(1);
-    }
-    if (parts_ops[p->type].drag_fini != NULL)
-	(*parts_ops[p->type].drag_fini)(p, x, y);
+    struct history_t *hp = data;
+    if (!draw_layers(hp, cr))
+	draw_parts(hp, cr, TRUE);
 }
 
-/****/
-
 static void draw(GtkWidget *drawable, cairo_t *cr, gpointer user_data)
 {
     struct parts_t *lp;
     
-    for (lp = undoable->parts_list; lp != NULL; lp = lp->next) {
-	cairo_save(cr);
-	call_draw(lp, cr, lp == undoable->selp);
-	cairo_restore(cr);
+    double x1, y1, x2, y2;
+    cairo_clip_extents(cr, &x1, &y1, &x2, &y2);
+    cairo_rectangle_int_t area;
+    bbox_from_corners(&area, floor(x1), floor(y1), ceil(x2), ceil(y2));
+    
+    struct parts_t *base = doc->hp->parts[0];
+    if (base->surface == NULL)
+	return;		/* still loading */
+    
+    cairo_surface_t *surface = canvas != NULL ? render_get_surface(canvas) : NULL;
+    if (surface == NULL
+	    || cairo_image_surface_get_width(surface) != base->width
+	    || cairo_image_surface_get_height(surface) != base->height) {
+	if (canvas != NULL)
+	    render_free(canvas);
+	canvas = render_new(base->width, base->height);
     }
     
-    if ((lp = undoable->selp) != NULL) {
+    for (int i = 0; i < doc->hp->nparts; i++)
+	call_prepare(render_ctx, doc->hp->parts[i]);
+    
+    /* only tiles damaged since the last time are rendered. */
+    render_update(canvas, doc->hp, &area, paint_canvas, doc->hp);
+    
+    cairo_save(cr);
+    cairo_set_source_surface(cr, render_get_surface(canvas), 0, 0);
+    cairo_paint(cr);
+    cairo_restore(cr);
+    
+    if ((lp = doc->hp->selp) != NULL) {
 	cairo_save(cr);
 	call_draw_handle(lp, cr);
 	cairo_restore(cr);
     }
     
-    struct parts_t *p = undoable->selp;
+    struct parts_t *p = doc->hp->selp;
     if (p == NULL) {
 	settings_set_color(NULL);
 	settings_set_font(NULL);
@@ -275,63 +259,101 @@ static void draw(GtkWidget *drawable, cairo_t *cr, gpointer user_data)
 
 /****/
 
+/* called after the history may have changed. */
+static void undo_label_update(void)
+{
+    static int shown = -1;
+    if (doc->undo_steps == shown)
+	return;
+    shown = doc->undo_steps;
+    
+    char buf[64];
+    snprintf(buf, sizeof buf, _("Undo: %d"), shown);
+    gtk_label_set_text(GTK_LABEL(undo_label), buf);
+}
+
+
+/* while the button is held, a part is being dragged or created. */
+static gboolean button_held = FALSE;
 
 static void button_event(GtkWidget *evbox, GdkEvent *ev, gpointer user_data)
 {
     gtk_widget_grab_focus(evbox);
+    if (ev->type == GDK_BUTTON_PRESS && ev->button.button == 1)
+	button_held = TRUE;
+    if (ev->type == GDK_BUTTON_RELEASE && ev->button.button == 1)
+	button_held = FALSE;
     mode_handle(ev);
+    undo_label_update();
+}
+
+/* the history and the order of parts can't change in the middle of
+ * editing a part, which holds on to it.
+ */
+static gboolean can_edit_history(void)
+{
+    return !text_has_focus() && !button_held;
+}
+
+/* undo and redo end the text edit first, instead. */
+static gboolean can_undo(void)
+{
+    if (button_held)
+	return FALSE;
+    if (text_has_focus())
+	mode_end_edit();
+    return TRUE;
 }
 
 static void delete_it(void)
 {
-    history_copy_top_of_undoable();
-    history_unlink_parts(undoable, undoable->selp);	/* leaks a little */
+    history_delete_parts(doc, doc->hp->selp);
 }
 
 static void raise_it(void)
 {
-    history_copy_top_of_undoable();
-    struct parts_t *p = undoable->selp;
-    history_unlink_parts(undoable, p);
-    history_append_parts(undoable, p);
-    undoable->selp = p;
+    history_move_parts(doc, doc->hp->selp, doc->hp->nparts - 1);
 }
 
 static void lower_it(void)
 {
-    history_copy_top_of_undoable();
-    struct parts_t *p = undoable->selp;
-    history_unlink_parts(undoable, p);
-    history_insert_parts_after(undoable, p, undoable->parts_list);
-    undoable->selp = p;
+    history_move_parts(doc, doc->hp->selp, 1);
 }
 
 static gboolean key_event(GtkWidget *widget, GdkEventKey *ev, gpointer user_data)
 {
     if (ev->type == GDK_KEY_PRESS) {
-	if (ev->keyval == GDK_KEY_z && (ev->state & GDK_MODIFIER_MASK) == GDK_CONTROL_MASK) {
-	    history_undo();
-	    gtk_widget_queue_draw(drawable);
+	if (ev->keyval == GDK_KEY_z && (ev->state & GDK_MODIFIER_MASK) == GDK_CONTROL_MASK && can_undo()) {
+	    history_undo(doc);
+	    undo_label_update();
+	    damage_all();
 	    return TRUE;
 	}
-	if (ev->keyval == GDK_KEY_Z && (ev->state & GDK_MODIFIER_MASK) == (GDK_CONTROL_MASK | GDK_SHIFT_MASK)) {
-	    history_redo();
-	    gtk_widget_queue_draw(drawable);
+	if (ev->keyval == GDK_KEY_Z && (ev->state & GDK_MODIFIER_MASK) == (GDK_CONTROL_MASK | GDK_SHIFT_MASK) && can_undo()) {
+	    history_redo(doc);
+	    undo_label_update();
+	    damage_all();
 	    return TRUE;
 	}
-	if (ev->keyval == GDK_KEY_BackSpace && !text_has_focus() && undoable->selp != NULL) {
+	if (ev->keyval == GDK_KEY_BackSpace && can_edit_history() && doc->hp->selp != NULL) {
+	    damage_add_parts(doc->hp->selp);
 	    delete_it();
-	    gtk_widget_queue_draw(drawable);
+	    undo_label_update();
+	    damage_flush();
 	    return TRUE;
 	}
-	if (ev->keyval == GDK_KEY_f && (ev->state & GDK_MODIFIER_MASK) == GDK_CONTROL_MASK && !text_has_focus() && undoable->selp != NULL) {
+	if (ev->keyval == GDK_KEY_f && (ev->state & GDK_MODIFIER_MASK) == GDK_CONTROL_MASK && can_edit_history() && doc->hp->selp != NULL) {
 	    raise_it();
-	    gtk_widget_queue_draw(drawable);
+	    undo_label_update();
+	    damage_add_parts(doc->hp->selp);
+	    damage_flush();
 	    return TRUE;
 	}
-	if (ev->keyval == GDK_KEY_b && (ev->state & GDK_MODIFIER_MASK) == GDK_CONTROL_MASK && !text_has_focus() && undoable->selp != NULL) {
+	if (ev->keyval == GDK_KEY_b && (ev->state & GDK_MODIFIER_MASK) == GDK_CONTROL_MASK && can_edit_history() && doc->hp->selp != NULL) {
 	    lower_it();
-	    gtk_widget_queue_draw(drawable);
+	    undo_label_update();
+	    damage_add_parts(doc->hp->selp);
+	    damage_flush();
 	    return TRUE;
 	}
 	if (ev->keyval == GDK_KEY_q && (ev->state & GDK_MODIFIER_MASK) == GDK_CONTROL_MASK) {
@@ -350,17 +372,65 @@ static void mode_cb(GtkToolButton *item, gpointer user_data)
     mode_switch(GPOINTER_TO_INT(user_data));
 }
 
-static cairo_status_t write_png_data(void *closure, const unsigned char *data, unsigned int length)
+/**** snapshot ****/
+
+/* a copy of the document to be rendered on other threads. the text is
+ * laid out here, since it uses pango, and without the text focus. the
+ * focused part gets a copy of its own in the snapshot, for the main
+ * thread goes on laying out that one with the cursor.
+ */
+static struct history_t *snapshot(void)
+{
+    struct history_t *hp = history_dup(doc->hp);
+    struct parts_t *focused = render_ctx->focus.parts;
+    
+    int i = focused != NULL ? history_index_of(hp, focused) : -1;
+    if (i >= 0) {
+	hp->parts[i] = parts_dup(focused);
+	parts_unref(focused);
+    }
+    hp->selp = NULL;
+    
+    render_ctx->focus.parts = NULL;
+    for (i = 0; i < hp->nparts; i++)
+	call_prepare(render_ctx, hp->parts[i]);
+    render_ctx->focus.parts = focused;
+    
+    return hp;
+}
+
+/**** export ****/
+
+/* exports are rendered and written on worker threads from snapshots of
+ * the document, so that editing can go on meanwhile.
+ */
+
+struct export_t {
+    struct history_t *hp;
+    char *fname;
+    int level;
+    gint progress;		/* in 1/1000, or -1 if unknown */
+};
+
+static GtkWidget *export_progress;
+static struct export_t *export_shown = NULL;	/* whose progress is shown */
+static int exports_running = 0;
+static guint export_pulse_id = 0;
+static gboolean quit_after_export = FALSE;
+static int export_level = PNG_LEVEL_DEFAULT;
+static char *export_output = NULL;	/* --output, or NULL to ask */
+
+static gboolean write_png_data(void *closure, const unsigned char *data, size_t length)
 {
     FILE *fp = closure;
-    if (fwrite(data, length, 1, fp) != 1)
-	return CAIRO_STATUS_WRITE_ERROR;
-    return CAIRO_STATUS_SUCCESS;
+    return fwrite(data, length, 1, fp) == 1;
 }
 
-static void save_as_png(cairo_surface_t *surface)
+/* asks the file name to save as, and the compression level.
+ * returns NULL if cancelled.
+ */
+static char *choose_png_file(int *level)
 {
-    int err;
     char *fname = NULL;
     GtkWidget *dialog = gtk_file_chooser_dialog_new(_("Save as PNG"),
 	    GTK_WINDOW(toplevel),
@@ -368,12 +438,31 @@ static void save_as_png(cairo_surface_t *surface)
 	    _("Cancel"), GTK_RESPONSE_CANCEL,
 	    _("OK"), GTK_RESPONSE_ACCEPT,
 	    NULL);
-    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT)
+    
+    GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 6);
+    GtkWidget *label = gtk_label_new(_("Compression:"));
+    gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
+    GtkWidget *combo = gtk_combo_box_text_new();
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(combo), G_STRINGIFY(PNG_LEVEL_FASTEST), _("Fastest"));
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(combo), G_STRINGIFY(PNG_LEVEL_DEFAULT), _("Default"));
+    gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(combo), G_STRINGIFY(PNG_LEVEL_SMALLEST), _("Smallest"));
+    char id[16];
+    sprintf(id, "%d", *level);
+    gtk_combo_box_set_active_id(GTK_COMBO_BOX(combo), id);
+    gtk_box_pack_start(GTK_BOX(hbox), combo, FALSE, FALSE, 0);
+    gtk_widget_show_all(hbox);
+    gtk_file_chooser_set_extra_widget(GTK_FILE_CHOOSER(dialog), hbox);
+    
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
 	fname = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+	const char *active = gtk_combo_box_get_active_id(GTK_COMBO_BOX(combo));
+	if (active != NULL)
+	    *level = atoi(active);
+    }
     gtk_widget_destroy(dialog);
     
     if (fname == NULL)
-	return;
+	return NULL;
     
     struct stat st;
     if (stat(fname, &st) == 0) {
@@ -385,120 +474,342 @@ static void save_as_png(cairo_surface_t *surface)
 		_("The file already exists. Overwrite it?"));
 	int res = gtk_dialog_run(GTK_DIALOG(dialog3));
 	gtk_widget_destroy(dialog3);
-	if (res != GTK_RESPONSE_OK)
-	    return;
+	if (res != GTK_RESPONSE_OK) {
+	    g_free(fname);
+	    return NULL;
+	}
     }
     
-    FILE *fp = fopen(fname, "wb");
+    return fname;
+}
+
+/* encodes the image into fp. */
+static gboolean write_png(struct export_t *ex, FILE *fp)
+{
+    return render_png(ex->hp, paint_history, ex->hp, ex->level, write_png_data, fp, &ex->progress);
+}
+
+/* writes to a temporary file next to fname, and renames it to fname
+ * once it is on the disk, so that fname is never left half written.
+ * called on a worker thread.
+ */
+static gboolean save_as_png(struct export_t *ex, GError **error)
+{
+    int err;
+    const char *fname = ex->fname;
+    
+    if (strcmp(fname, "-") == 0) {
+	if (!write_png(ex, stdout) || fflush(stdout) == EOF) {
+	    err = errno;
+	    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(err), "%s: %s", strerror(err), _("standard output"));
+	    return FALSE;
+	}
+	return TRUE;
+    }
+    
+    char *tmpname = g_strdup_printf("%s.XXXXXX", fname);
+    
+    int fd = g_mkstemp_full(tmpname, O_WRONLY, 0666);
+    if (fd == -1) {
+	err = errno;
+	g_free(tmpname);
+	g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(err), "%s: %s", strerror(err), fname);
+	return FALSE;
+    }
+    FILE *fp = fdopen(fd, "wb");
     if (fp == NULL) {
 	err = errno;
+	close(fd);
 	goto err;
     }
     
-    cairo_surface_write_to_png_stream(surface, write_png_data, fp);
-    
-    if (ferror(fp)) {
+    if (!write_png(ex, fp)) {
 	err = errno;
 	fclose(fp);
 	goto err;
     }
     
+    if (fflush(fp) == EOF || fsync(fileno(fp)) == -1) {
+	err = errno;
+	fclose(fp);
+	goto err;
+    }
     if (fclose(fp) == EOF) {
 	err = errno;
 	goto err;
     }
     
-    return;
+    if (rename(tmpname, fname) == -1) {
+	err = errno;
+	goto err;
+    }
+    
+    g_free(tmpname);
+    return TRUE;
     
  err:
-    (void) 0;
-    GtkWidget *dialog2 = gtk_message_dialog_new(
-	    GTK_WINDOW(toplevel),
-	    GTK_DIALOG_MODAL,
-	    GTK_MESSAGE_ERROR,
-	    GTK_BUTTONS_CLOSE,
-	    "%s: %s", strerror(err), fname);
-    gtk_dialog_run(GTK_DIALOG(dialog2));
-    gtk_widget_destroy(dialog2);
+    unlink(tmpname);
+    g_free(tmpname);
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(err), "%s: %s", strerror(err), fname);
+    return FALSE;
+}
+
+/* exports hp to fname on this thread, for batch mode. */
+gboolean export_png(struct history_t *hp, const char *fname, int level, GError **error)
+{
+    struct export_t ex = {
+	.hp = hp,
+	.fname = (char *) fname,
+	.level = level,
+	.progress = -1,
+    };
+    return save_as_png(&ex, error);
+}
+
+static void export_free(struct export_t *ex)
+{
+    history_free(ex->hp);
+    g_free(ex->fname);
+    g_free(ex);
+}
+
+static void export_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+    struct export_t *ex = task_data;
+    GError *error = NULL;
+    
+    if (save_as_png(ex, &error))
+	g_task_return_boolean(task, TRUE);
+    else
+	g_task_return_error(task, error);
+}
+
+static gboolean export_pulse(gpointer user_data)
+{
+    int progress = export_shown != NULL ? g_atomic_int_get(&export_shown->progress) : -1;
+    if (progress >= 0)
+	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(export_progress), progress / 1000.0);
+    else
+	gtk_progress_bar_pulse(GTK_PROGRESS_BAR(export_progress));
+    return G_SOURCE_CONTINUE;
+}
+
+static void export_done(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    GError *error = NULL;
+    
+    if (g_task_get_task_data(G_TASK(res)) == export_shown)
+	export_shown = NULL;
+    
+    if (!g_task_propagate_boolean(G_TASK(res), &error)) {
+	GtkWidget *dialog = gtk_message_dialog_new(
+		GTK_WINDOW(toplevel),
+		GTK_DIALOG_MODAL,
+		GTK_MESSAGE_ERROR,
+		GTK_BUTTONS_CLOSE,
+		"%s", error->message);
+	gtk_dialog_run(GTK_DIALOG(dialog));
+	gtk_widget_destroy(dialog);
+	g_error_free(error);
+    }
+    
+    if (--exports_running == 0) {
+	g_source_remove(export_pulse_id);
+	export_pulse_id = 0;
+	gtk_widget_hide(export_progress);
+	if (quit_after_export)
+	    exit(0);
+    }
 }
 
 static void export(GtkToolButton *item, gpointer user_data)
 {
-    int width = undoable->parts_list->width;
-    int height = undoable->parts_list->height;
-    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
-    cairo_t *cr = cairo_create(surface);
+    char *fname;
+    if (export_output != NULL)
+	fname = g_strdup(export_output);
+    else if ((fname = choose_png_file(&export_level)) == NULL)
+	return;
     
-    for (struct parts_t *lp = undoable->parts_list; lp != NULL; lp = lp->next) {
-	cairo_save(cr);
-	call_draw(lp, cr, FALSE);
-	cairo_restore(cr);
+    if (strcmp(fname, "-") == 0) {
+	/* the standard output can take only one image. */
+	gtk_widget_set_sensitive(GTK_WIDGET(item), FALSE);
+	quit_after_export = TRUE;
     }
-    cairo_surface_flush(surface);
     
-    save_as_png(surface);
+    struct export_t *ex = g_new0(struct export_t, 1);
+    ex->hp = snapshot();
+    ex->fname = fname;
+    ex->level = export_level;
+    ex->progress = -1;
     
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
+    GTask *task = g_task_new(NULL, NULL, export_done, NULL);
+    g_task_set_task_data(task, ex, (GDestroyNotify) export_free);
+    g_task_run_in_thread(task, export_thread);
+    g_object_unref(task);
+    
+    export_shown = ex;
+    if (exports_running++ == 0) {
+	gtk_widget_show(export_progress);
+	export_pulse_id = g_timeout_add(100, export_pulse, NULL);
+    }
 }
 
-static void copy(GtkToolButton *item, gpointer user_data)
+/* exports being written are finished before quitting. */
+static gboolean delete_event(GtkWidget *widget, GdkEvent *ev, gpointer user_data)
+{
+    if (exports_running == 0)
+	exit(0);
+    quit_after_export = TRUE;
+    gtk_widget_hide(toplevel);
+    return TRUE;
+}
+
+/**** copy ****/
+
+/* copy() only takes a snapshot. it is rendered and encoded when pasted,
+ * and the data is kept for each target, for the next paste.
+ */
+
+struct clip_t {
+    struct history_t *hp;
+    cairo_surface_t *surface;	/* rendered at the first paste */
+    GHashTable *data;		/* target atom -> GBytes */
+};
+
+static gboolean write_byte_array(void *closure, const unsigned char *data, size_t length)
 {
-    int width = undoable->parts_list->width;
-    int height = undoable->parts_list->height;
-    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
-    cairo_t *cr = cairo_create(surface);
+    g_byte_array_append(closure, data, length);
+    return TRUE;
+}
 
-    for (struct parts_t *lp = undoable->parts_list; lp != NULL; lp = lp->next) {
-    cairo_save(cr);
-    call_draw(lp, cr, FALSE);
-    cairo_restore(cr);
+static cairo_surface_t *clip_get_surface(struct clip_t *clip)
+{
+    if (clip->surface == NULL) {
+	int width = clip->hp->parts[0]->width;
+	int height = clip->hp->parts[0]->height;
+	clip->surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+	render_all(clip->surface, clip->hp, paint_history, clip->hp);
     }
-    cairo_surface_flush(surface);
+    return clip->surface;
+}
 
-    GtkClipboard *clip = gtk_clipboard_get (GDK_SELECTION_CLIPBOARD);
-    GdkPixbuf *pixbuf = gdk_pixbuf_get_from_surface (surface, 0, 0, width, height);
-    gtk_clipboard_set_image (clip, pixbuf);
-    g_object_unref (pixbuf);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
+static void clip_get(GtkClipboard *clipboard, GtkSelectionData *sel, guint info, gpointer user_data)
+{
+    struct clip_t *clip = user_data;
+    GdkAtom target = gtk_selection_data_get_target(sel);
+    
+    GBytes *bytes = g_hash_table_lookup(clip->data, target);
+    if (bytes != NULL) {
+	gsize len;
+	const guchar *data = g_bytes_get_data(bytes, &len);
+	gtk_selection_data_set(sel, target, 8, data, len);
+	return;
+    }
+    
+    cairo_surface_t *surface = clip_get_surface(clip);
+    
+    if (target == gdk_atom_intern_static_string("image/png")) {
+	/* our encoder is faster than that of gdk-pixbuf. */
+	GByteArray *buf = g_byte_array_new();
+	struct png_writer_t *w = png_writer_new(
+		cairo_image_surface_get_width(surface), cairo_image_surface_get_height(surface),
+		PNG_LEVEL_FASTEST, write_byte_array, buf);
+	png_writer_add_rows(w, cairo_image_surface_get_data(surface),
+		cairo_image_surface_get_stride(surface), cairo_image_surface_get_height(surface));
+	png_writer_finish(w);
+	gtk_selection_data_set(sel, target, 8, buf->data, buf->len);
+	g_byte_array_unref(buf);
+    } else {
+	GdkPixbuf *pixbuf = gdk_pixbuf_get_from_surface(surface, 0, 0,
+		cairo_image_surface_get_width(surface), cairo_image_surface_get_height(surface));
+	gtk_selection_data_set_pixbuf(sel, pixbuf);
+	g_object_unref(pixbuf);
+    }
+    
+    gint len = gtk_selection_data_get_length(sel);
+    if (len >= 0) {
+	bytes = g_bytes_new(gtk_selection_data_get_data(sel), len);
+	g_hash_table_insert(clip->data, target, bytes);
+    }
+}
+
+static void clip_clear(GtkClipboard *clipboard, gpointer user_data)
+{
+    struct clip_t *clip = user_data;
+    
+    g_hash_table_destroy(clip->data);
+    if (clip->surface != NULL)
+	cairo_surface_destroy(clip->surface);
+    history_free(clip->hp);
+    g_free(clip);
+}
 
+static void copy(GtkToolButton *item, gpointer user_data)
+{
+    struct clip_t *clip = g_new0(struct clip_t, 1);
+    clip->hp = snapshot();
+    clip->data = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify) g_bytes_unref);
+    
+    GtkTargetList *list = gtk_target_list_new(NULL, 0);
+    gtk_target_list_add_image_targets(list, 0, TRUE);
+    int n;
+    GtkTargetEntry *targets = gtk_target_table_new_from_list(list, &n);
+    
+    GtkClipboard *clipboard = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
+    if (!gtk_clipboard_set_with_data(clipboard, targets, n, clip_get, clip_clear, clip))
+	clip_clear(clipboard, clip);
+    gtk_clipboard_set_can_store(clipboard, NULL, 0);
+    
+    gtk_target_table_free(targets, n);
+    gtk_target_list_unref(list);
 }
 
 static void color_changed_cb(const GdkRGBA *rgba)
 {
-    if (undoable->selp != NULL) {
-	history_copy_top_of_undoable();
-	undoable->selp->fg = *rgba;
+    if (doc->hp->selp != NULL) {
+	history_change_parts(doc, doc->hp->selp, CHANGE_COLOR);
+	doc->hp->selp->fg = *rgba;
 	
-	gtk_widget_queue_draw(drawable);
-    } else
+	damage_add_parts(doc->hp->selp);
+	undo_label_update();
+	damage_flush();
+    } else {
 	settings_set_default_color(rgba);
+	render_ctx->color = *rgba;
+    }
 }
 
 static void font_changed_cb(const char *fontname)
 {
-    if (undoable->selp != NULL) {
-	history_copy_top_of_undoable();
-	struct parts_t *p = undoable->selp;
-	if (p->fontname != NULL)
-	    g_free(p->fontname);
-	p->fontname = g_strdup(fontname);
+    if (doc->hp->selp != NULL) {
+	struct parts_t *p = history_change_parts(doc, doc->hp->selp, CHANGE_FONT);
+	damage_add_parts(p);
+	p->fontname = g_intern_string(fontname);
 	
-	gtk_widget_queue_draw(drawable);
-    } else
+	damage_add_parts(p);
+	undo_label_update();
+	damage_flush();
+    } else {
 	settings_set_default_font(fontname);
+	g_free(render_ctx->fontname);
+	render_ctx->fontname = g_strdup(fontname);
+    }
 }
 
 static void thickness_changed_cb(int thickness)
 {
-    if (undoable->selp != NULL) {
-	history_copy_top_of_undoable();
-	undoable->selp->thickness = thickness;
+    if (doc->hp->selp != NULL) {
+	history_change_parts(doc, doc->hp->selp, CHANGE_THICKNESS);
+	damage_add_parts(doc->hp->selp);
+	doc->hp->selp->thickness = thickness;
 	
-	gtk_widget_queue_draw(drawable);
-    } else
+	damage_add_parts(doc->hp->selp);
+	undo_label_update();
+	damage_flush();
+    } else {
 	settings_set_default_thickness(thickness);
+	render_ctx->thickness = thickness;
+    }
 }
 
 static void show_about_dialog(GtkWidget *widget, gpointer user_data)
@@ -515,44 +826,278 @@ static void show_about_dialog(GtkWidget *widget, gpointer user_data)
     gtk_widget_destroy(dialog);
 }
 
+/**** load ****/
+
+/* the image is decoded on a worker thread while the window is being built.
+ * decoded rows are sent to the main thread, which copies them into the
+ * base surface, so that the base is written only by the main thread.
+ * the tools are enabled when it is all decoded.
+ */
+
+#define LOAD_CHUNK_SIZE	(64 * 1024)
+
+enum {
+    LOAD_PREPARED,
+    LOAD_UPDATED,
+    LOAD_DONE,
+    LOAD_FAILED,
+};
+
+struct load_msg_t {
+    int type;
+    int x, y, width, height;
+    gboolean has_alpha;
+    GdkPixbuf *pixbuf;		/* the updated area */
+    char *message;
+};
+
+static GSList *load_widgets = NULL;	/* enabled when loaded */
+
+/* sources of the same priority are dispatched in the order they are added,
+ * so messages arrive in order.
+ */
+static void load_post(struct load_msg_t *msg);
+
+static void load_area_prepared(GdkPixbufLoader *loader, gpointer user_data)
+{
+    GdkPixbuf *pixbuf = gdk_pixbuf_loader_get_pixbuf(loader);
+    struct load_msg_t *msg = g_new0(struct load_msg_t, 1);
+    msg->type = LOAD_PREPARED;
+    msg->width = gdk_pixbuf_get_width(pixbuf);
+    msg->height = gdk_pixbuf_get_height(pixbuf);
+    msg->has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+    load_post(msg);
+}
+
+static void load_area_updated(GdkPixbufLoader *loader, int x, int y, int width, int height, gpointer user_data)
+{
+    GdkPixbuf *pixbuf = gdk_pixbuf_loader_get_pixbuf(loader);
+    GdkPixbuf *sub = gdk_pixbuf_new_subpixbuf(pixbuf, x, y, width, height);
+    struct load_msg_t *msg = g_new0(struct load_msg_t, 1);
+    msg->type = LOAD_UPDATED;
+    msg->x = x;
+    msg->y = y;
+    msg->width = width;
+    msg->height = height;
+    /* the loader goes on writing to its pixbuf, so pass a copy. */
+    msg->pixbuf = gdk_pixbuf_copy(sub);
+    g_object_unref(sub);
+    load_post(msg);
+}
+
+/* the image is read from fd if it is not -1, or else from the file fname. */
+struct load_src_t {
+    char *fname;
+    int fd;
+};
+
+static gpointer load_thread(gpointer data)
+{
+    struct load_src_t *src = data;
+    const char *fname = src->fname;
+    struct load_msg_t *msg = g_new0(struct load_msg_t, 1);
+    GError *err = NULL;
+    
+    GdkPixbufLoader *loader = gdk_pixbuf_loader_new();
+    g_signal_connect(G_OBJECT(loader), "area-prepared", G_CALLBACK(load_area_prepared), NULL);
+    g_signal_connect(G_OBJECT(loader), "area-updated", G_CALLBACK(load_area_updated), NULL);
+    
+    int fd = src->fd;
+    if (fd == -1 && (fd = open(fname, O_RDONLY)) == -1) {
+	msg->message = g_strdup_printf("%s: %s\n", fname, strerror(errno));
+	gdk_pixbuf_loader_close(loader, NULL);
+	goto end;
+    }
+    
+    /* pipes give what is there, so the loader gets rows as soon as
+     * they are written by the other end.
+     */
+    guchar *buf = g_malloc(LOAD_CHUNK_SIZE);
+    ssize_t len;
+    gboolean ok = TRUE;
+    while (ok) {
+	len = read(fd, buf, LOAD_CHUNK_SIZE);
+	if (len == -1 && errno == EINTR)
+	    continue;
+	if (len == -1) {
+	    msg->message = g_strdup_printf("%s: %s\n", fname, strerror(errno));
+	    ok = FALSE;
+	    break;
+	}
+	if (len == 0)
+	    break;
+	ok = gdk_pixbuf_loader_write(loader, buf, len, &err);
+    }
+    g_free(buf);
+    close(fd);
+    
+    if (ok)
+	ok = gdk_pixbuf_loader_close(loader, &err);
+    else
+	gdk_pixbuf_loader_close(loader, NULL);
+    if (err != NULL) {
+	msg->message = g_strdup_printf("%s\n", err->message);
+	g_error_free(err);
+    }
+    
+ end:
+    g_object_unref(loader);
+    msg->type = msg->message == NULL ? LOAD_DONE : LOAD_FAILED;
+    load_post(msg);
+    g_free(src->fname);
+    g_free(src);
+    return NULL;
+}
+
+static gboolean load_handle(gpointer data)
+{
+    struct load_msg_t *msg = data;
+    struct parts_t *base = history_writable_parts(doc->hp, doc->hp->parts[0]);
+    
+    switch (msg->type) {
+    case LOAD_PREPARED:
+	base->width = msg->width;
+	base->height = msg->height;
+	base->surface = cairo_image_surface_create(
+		msg->has_alpha ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24, base->width, base->height);
+	gtk_widget_set_size_request(drawable, base->width, base->height);
+	damage_all();
+	break;
+	
+    case LOAD_UPDATED:
+	{
+	    cairo_t *cr = cairo_create(base->surface);
+	    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	    gdk_cairo_set_source_pixbuf(cr, msg->pixbuf, msg->x, msg->y);
+	    cairo_rectangle(cr, msg->x, msg->y, msg->width, msg->height);
+	    cairo_fill(cr);
+	    cairo_destroy(cr);
+	    g_object_unref(msg->pixbuf);
+	    
+	    cairo_rectangle_int_t rect = { msg->x, msg->y, msg->width, msg->height };
+	    if (canvas != NULL)
+		render_invalidate(canvas, &rect);
+	    gtk_widget_queue_draw_area(drawable, rect.x, rect.y, rect.width, rect.height);
+	}
+	break;
+	
+    case LOAD_DONE:
+	for (GSList *lp = load_widgets; lp != NULL; lp = lp->next)
+	    gtk_widget_set_sensitive(lp->data, TRUE);
+	g_slist_free(load_widgets);
+	load_widgets = NULL;
+	gtk_widget_grab_focus(evbox);
+	break;
+	
+    case LOAD_FAILED:
+	fprintf(stderr, "%s", msg->message);
+	exit(1);
+    }
+    
+    g_free(msg->message);
+    g_free(msg);
+    return G_SOURCE_REMOVE;
+}
+
+static void load_post(struct load_msg_t *msg)
+{
+    g_idle_add_full(G_PRIORITY_DEFAULT, load_handle, msg, NULL);
+}
+
+/* fname is used in messages if fd is not -1. */
+static void load_start(const char *fname, int fd)
+{
+    struct parts_t *initial = parts_alloc(render_ctx);
+    initial->type = PARTS_BASE;
+    /* the size is not known yet. */
+    initial->width = 0;
+    initial->height = 0;
+    initial->surface = NULL;
+    
+    doc = document_new(render_ctx, initial);
+    if (undo_memory >= 0)
+	doc->undo_budget = (size_t) undo_memory << 20;
+    
+    struct load_src_t *src = g_new0(struct load_src_t, 1);
+    src->fname = g_strdup(fname);
+    src->fd = fd;
+    g_thread_unref(g_thread_new("load", load_thread, src));
+}
+
+/* w is disabled until the image is loaded. */
+static void load_wait(GtkWidget *w)
+{
+    gtk_widget_set_sensitive(w, FALSE);
+    load_widgets = g_slist_prepend(load_widgets, w);
+}
+
 int main(int argc, char **argv)
 {
+    int input_fd = -1;
+    char *batch_desc = NULL;
+    GOptionEntry options[] = {
+	{ "fd", 0, 0, G_OPTION_ARG_INT, &input_fd, N_("Read the image from file descriptor N"), "N" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &export_output,
+	  N_("Export to FILE without asking, or to the standard output and quit if FILE is -"), "FILE" },
+	{ "batch", 0, 0, G_OPTION_ARG_FILENAME, &batch_desc,
+	  N_("Annotate the images as described in FILE without the window, into the directory given by --output"), "FILE" },
+	{ "undo-memory", 0, 0, G_OPTION_ARG_INT, &undo_memory,
+	  N_("Keep at most N MiB for undo, dropping the oldest steps (0: no limit)"), "N" },
+	{ NULL },
+    };
+    
     setlocale(LC_ALL, "");
     bindtextdomain(PACKAGE, LOCALEDIR);
     textdomain(PACKAGE);
     
-    gtk_init(&argc, &argv);
-    if (argc < 2) {
-	fprintf(stderr, "usage: gpicann <filename.png>\n");
+    /* the display is opened only if not in batch mode. */
+    GError *err = NULL;
+    GOptionContext *context = g_option_context_new("<filename.png|->");
+    g_option_context_add_main_entries(context, options, PACKAGE);
+    g_option_context_add_group(context, gtk_get_option_group(FALSE));
+    if (!g_option_context_parse(context, &argc, &argv, &err)) {
+	fprintf(stderr, "%s\n", err->message);
 	exit(1);
     }
+    g_option_context_free(context);
     
-    undoable = NULL;
-    redoable = NULL;
-    
-    prepare_icons();
+    if (batch_desc != NULL) {
+	if (export_output == NULL || argc < 2) {
+	    fprintf(stderr, "usage: gpicann --batch <annotations> --output <dir> <filename.png>...\n");
+	    exit(1);
+	}
+	return batch_main(batch_desc, export_output, argc - 1, argv + 1);
+    }
     
-    GError *err = NULL;
-    GdkPixbuf *pixbuf = gdk_pixbuf_new_from_file(argv[1], &err);
-    if (pixbuf == NULL) {
-	fprintf(stderr, "%s", err->message);
+    if (!gtk_init_check(&argc, &argv)) {
+	fprintf(stderr, "cannot open display.\n");
+	exit(1);
+    }
+    if (input_fd == -1 ? argc != 2 : argc != 1) {
+	fprintf(stderr, "usage: gpicann [--output <filename.png|->] <filename.png|-|--fd N>\n");
 	exit(1);
     }
     
-    struct parts_t *initial = parts_alloc();
-    initial->type = PARTS_BASE;
-    initial->width = gdk_pixbuf_get_width(pixbuf);
-    initial->height = gdk_pixbuf_get_height(pixbuf);
-    initial->pixbuf = pixbuf;
+    /* text is laid out as it is shown on the screen. */
+    render_ctx = render_ctx_new();
+    GdkScreen *screen = gdk_screen_get_default();
+    if (gdk_screen_get_font_options(screen) != NULL)
+	pango_cairo_context_set_font_options(render_ctx->pango, gdk_screen_get_font_options(screen));
+    pango_cairo_context_set_resolution(render_ctx->pango, gdk_screen_get_resolution(screen));
     
-    struct history_t *hist = g_new0(struct history_t, 1);
-    hist->parts_list = initial;
+    prepare_icons();
     
-    undoable = hist;
-    redoable = NULL;
+    if (input_fd != -1) {
+	char *name = g_strdup_printf("fd %d", input_fd);
+	load_start(name, input_fd);
+	g_free(name);
+    } else if (strcmp(argv[1], "-") == 0)
+	load_start(_("standard input"), 0);
+    else
+	load_start(argv[1], -1);
     
     toplevel = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-    g_signal_connect_swapped(G_OBJECT(toplevel), "delete-event", G_CALLBACK(exit), 0);
+    g_signal_connect(G_OBJECT(toplevel), "delete-event", G_CALLBACK(delete_event), NULL);
     gtk_widget_show(toplevel);
     
     GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
@@ -574,6 +1119,7 @@ int main(int argc, char **argv)
 	g_signal_connect(G_OBJECT(item), "clicked", G_CALLBACK(export), NULL);
 	gtk_toolbar_insert(GTK_TOOLBAR(toolbar), item, -1);
 	gtk_widget_show(GTK_WIDGET(item));
+	load_wait(GTK_WIDGET(item));
     }
     {
     GtkToolItem *item = gtk_tool_button_new(NULL, "Copy");
@@ -582,6 +1128,7 @@ int main(int argc, char **argv)
     g_signal_connect(G_OBJECT(item), "clicked", G_CALLBACK(copy), NULL);
     gtk_toolbar_insert(GTK_TOOLBAR(toolbar), item, -1);
     gtk_widget_show(GTK_WIDGET(item));
+    load_wait(GTK_WIDGET(item));
     }
     {
 	GtkToolItem *item = gtk_separator_tool_item_new();
@@ -607,6 +1154,7 @@ int main(int argc, char **argv)
 	g_signal_connect(G_OBJECT(item), "clicked", G_CALLBACK(mode_cb), GINT_TO_POINTER(mode_buttons[i].mode));
 	gtk_toolbar_insert(GTK_TOOLBAR(toolbar), item, -1);
 	gtk_widget_show(GTK_WIDGET(item));
+	load_wait(GTK_WIDGET(item));
 	
 	last_radio_tool_button = GTK_RADIO_TOOL_BUTTON(item);
     }
@@ -616,9 +1164,21 @@ int main(int argc, char **argv)
 	gtk_widget_show(GTK_WIDGET(item));
     }
     
+    export_progress = gtk_progress_bar_new();
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(export_progress), _("Exporting..."));
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(export_progress), TRUE);
+    gtk_widget_set_valign(export_progress, GTK_ALIGN_CENTER);
+    gtk_box_pack_start(GTK_BOX(hbox), export_progress, FALSE, FALSE, 0);
+    
+    undo_label = gtk_label_new(NULL);
+    gtk_box_pack_start(GTK_BOX(hbox), undo_label, FALSE, FALSE, 0);
+    gtk_widget_show(undo_label);
+    undo_label_update();
+    
     GtkWidget *settings = settings_create_widgets();
     gtk_box_pack_start(GTK_BOX(hbox), settings, FALSE, FALSE, 0);
     gtk_widget_show(settings);
+    load_wait(settings);
     settings_set_color_changed_callback(color_changed_cb);
     settings_set_font_changed_callback(font_changed_cb);
     settings_set_thickness_changed_callback(thickness_changed_cb);
@@ -647,16 +1207,16 @@ int main(int argc, char **argv)
     g_signal_connect(G_OBJECT(evbox), "button-release-event", G_CALLBACK(button_event), NULL);
     g_signal_connect(G_OBJECT(evbox), "motion-notify-event", G_CALLBACK(button_event), NULL);
     gtk_widget_show(evbox);
+    load_wait(evbox);
     gtk_box_pack_start(GTK_BOX(vbox), evbox, TRUE, TRUE, 0);
     
     drawable = gtk_drawing_area_new();
     g_signal_connect(G_OBJECT(drawable), "draw", G_CALLBACK(draw), NULL);
-    gtk_widget_set_size_request(drawable, initial->width, initial->height);
     gtk_widget_show(drawable);
     gtk_container_add(GTK_CONTAINER(evbox), drawable);
     
     mode_init(drawable);
-    text_init(toplevel, drawable);
+    text_init(toplevel, render_ctx);
     
     gtk_main();
     return 0;
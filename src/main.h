@@ -0,0 +1,33 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MAIN_H__INCLUDED
+#define MAIN_H__INCLUDED
+
+/* in the window, not in the library. */
+extern struct document_t *doc;
+
+void damage_add_parts(struct parts_t *p);
+void damage_flush(void);
+void damage_all(void);
+void layer_cache_build(int index);
+void layer_cache_drop(void);
+
+gboolean export_png(struct history_t *hp, const char *fname, int level, GError **error);
+
+void prepare_icons(void);
+
+#endif	/* ifndef MAIN_H__INCLUDED */
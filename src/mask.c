@@ -16,13 +16,17 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <gtk/gtk.h>
 #include <math.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include "common.h"
 #include "shapes.h"
 #include "handle.h"
-#include "settings.h"
+#include "bbox.h"
 
 enum {
     HANDLE_TOP_LEFT,
@@ -37,10 +41,6 @@ enum {
     HANDLE_NR
 };
 
-static int beg_x = 0, beg_y = 0;
-static int orig_x = 0, orig_y = 0, orig_w = 0, orig_h = 0;
-static int dragging_handle = -1;
-
 static void make_handle_geoms(struct parts_t *p, struct handle_t *bufp)
 {
     struct handle_t *bp = bufp;
@@ -80,7 +80,40 @@ static void make_handle_geoms(struct parts_t *p, struct handle_t *bufp)
     handle_calc_geom(bufp, HANDLE_NR);
 }
 
-static unsigned int avg_color(unsigned char *data, int width, int height, int stride, int cx, int cy)
+/* summed-area table of r, g and b: sat[((y * (width + 1)) + x) * 3 + c] is the
+ * sum of the channel c over [0, x) x [0, y).
+ * sums wrap around on huge images, but differences of them are still right
+ * as long as a window sums to less than 2^32.
+ */
+static uint32_t *make_sat(unsigned char *data, int width, int height, int stride)
+{
+    int w1 = width + 1;
+    uint32_t *sat = g_new(uint32_t, (size_t) w1 * (height + 1) * 3);
+    
+    memset(sat, 0, sizeof *sat * w1 * 3);
+    for (int y = 0; y < height; y++) {
+	uint32_t *up = sat + (size_t) w1 * y * 3;
+	uint32_t *dp = up + w1 * 3;
+	uint32_t *sp = (uint32_t *) (data + stride * y);
+	uint32_t sum_r = 0, sum_g = 0, sum_b = 0;
+	dp[0] = dp[1] = dp[2] = 0;
+	for (int x = 0; x < width; x++) {
+	    uint32_t rgb = *sp++;
+	    sum_r += (rgb >> 16) & 0xff;
+	    sum_g += (rgb >>  8) & 0xff;
+	    sum_b += (rgb >>  0) & 0xff;
+	    up += 3;
+	    dp += 3;
+	    dp[0] = up[0] + sum_r;
+	    dp[1] = up[1] + sum_g;
+	    dp[2] = up[2] + sum_b;
+	}
+    }
+    
+    return sat;
+}
+
+static unsigned int avg_color(uint32_t *sat, int width, int height, int cx, int cy)
 {
     int beg_x = cx - 32 / 2;
     int end_x = cx + 32 / 2;
@@ -95,62 +128,227 @@ static unsigned int avg_color(unsigned char *data, int width, int height, int st
     if (end_y >= height)
 	end_y = height;
     
-    unsigned long avg_r = 0, avg_g = 0, avg_b = 0;
-    unsigned int n = 0;
-    for (int y = beg_y; y < end_y; y++) {
-	unsigned char *p = data + stride * y + beg_x * 4;
-	for (int x = beg_x; x < end_x; x++) {
-	    unsigned int rgb = *(uint32_t *) p;
-	    avg_r += (rgb >> 16) & 0xff;
-	    avg_g += (rgb >>  8) & 0xff;
-	    avg_b += (rgb >>  0) & 0xff;
-	    n++;
-	    p += 4;
-	}
-    }
+    int w1 = width + 1;
+    uint32_t *p00 = sat + ((size_t) w1 * beg_y + beg_x) * 3;
+    uint32_t *p01 = sat + ((size_t) w1 * beg_y + end_x) * 3;
+    uint32_t *p10 = sat + ((size_t) w1 * end_y + beg_x) * 3;
+    uint32_t *p11 = sat + ((size_t) w1 * end_y + end_x) * 3;
+    unsigned int n = (end_x - beg_x) * (end_y - beg_y);
+    
+    uint32_t avg_r = p11[0] - p10[0] - p01[0] + p00[0];
+    uint32_t avg_g = p11[1] - p10[1] - p01[1] + p00[1];
+    uint32_t avg_b = p11[2] - p10[2] - p01[2] + p00[2];
     
     return (avg_r / n) << 16 | (avg_g / n) << 8 | (avg_b / n);
 }
 
+/* fills a row of n pixels, starting with the channels (r, g, b) and
+ * stepping by (dr, dg, db). channels are in 16.16 fixed point, and stay
+ * in [0, 256) because they are interpolated between two bytes.
+ */
+static void grad_row_scalar(uint32_t *dp, int n,
+	int32_t r, int32_t g, int32_t b, int32_t dr, int32_t dg, int32_t db)
+{
+    for (int i = 0; i < n; i++) {
+	*dp++ = (r & 0xff0000) | ((g >> 8) & 0xff00) | (b >> 16);
+	r += dr;
+	g += dg;
+	b += db;
+    }
+}
+
+#if defined(__AVX2__)
+
+static void grad_row(uint32_t *dp, int n,
+	int32_t r, int32_t g, int32_t b, int32_t dr, int32_t dg, int32_t db)
+{
+    __m256i step = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i vr = _mm256_add_epi32(_mm256_set1_epi32(r), _mm256_mullo_epi32(step, _mm256_set1_epi32(dr)));
+    __m256i vg = _mm256_add_epi32(_mm256_set1_epi32(g), _mm256_mullo_epi32(step, _mm256_set1_epi32(dg)));
+    __m256i vb = _mm256_add_epi32(_mm256_set1_epi32(b), _mm256_mullo_epi32(step, _mm256_set1_epi32(db)));
+    __m256i dr8 = _mm256_set1_epi32(dr * 8);
+    __m256i dg8 = _mm256_set1_epi32(dg * 8);
+    __m256i db8 = _mm256_set1_epi32(db * 8);
+    __m256i mask_r = _mm256_set1_epi32(0xff0000);
+    __m256i mask_g = _mm256_set1_epi32(0xff00);
+    
+    int i;
+    for (i = 0; i + 8 <= n; i += 8) {
+	__m256i px = _mm256_or_si256(
+		_mm256_or_si256(_mm256_and_si256(vr, mask_r),
+			_mm256_and_si256(_mm256_srli_epi32(vg, 8), mask_g)),
+		_mm256_srli_epi32(vb, 16));
+	_mm256_storeu_si256((__m256i *) (dp + i), px);
+	vr = _mm256_add_epi32(vr, dr8);
+	vg = _mm256_add_epi32(vg, dg8);
+	vb = _mm256_add_epi32(vb, db8);
+    }
+    
+    grad_row_scalar(dp + i, n - i, r + dr * i, g + dg * i, b + db * i, dr, dg, db);
+}
+
+#elif defined(__SSE2__)
+
+static void grad_row(uint32_t *dp, int n,
+	int32_t r, int32_t g, int32_t b, int32_t dr, int32_t dg, int32_t db)
+{
+    __m128i vr = _mm_setr_epi32(r, r + dr, r + dr * 2, r + dr * 3);
+    __m128i vg = _mm_setr_epi32(g, g + dg, g + dg * 2, g + dg * 3);
+    __m128i vb = _mm_setr_epi32(b, b + db, b + db * 2, b + db * 3);
+    __m128i dr4 = _mm_set1_epi32(dr * 4);
+    __m128i dg4 = _mm_set1_epi32(dg * 4);
+    __m128i db4 = _mm_set1_epi32(db * 4);
+    __m128i mask_r = _mm_set1_epi32(0xff0000);
+    __m128i mask_g = _mm_set1_epi32(0xff00);
+    
+    int i;
+    for (i = 0; i + 4 <= n; i += 4) {
+	__m128i px = _mm_or_si128(
+		_mm_or_si128(_mm_and_si128(vr, mask_r),
+			_mm_and_si128(_mm_srli_epi32(vg, 8), mask_g)),
+		_mm_srli_epi32(vb, 16));
+	_mm_storeu_si128((__m128i *) (dp + i), px);
+	vr = _mm_add_epi32(vr, dr4);
+	vg = _mm_add_epi32(vg, dg4);
+	vb = _mm_add_epi32(vb, db4);
+    }
+    
+    grad_row_scalar(dp + i, n - i, r + dr * i, g + dg * i, b + db * i, dr, dg, db);
+}
+
+#else
+
+#define grad_row grad_row_scalar
+
+#endif
+
+/* a value between a and b at t / n, in 16.16 fixed point, rounded. */
+static inline int32_t lerp_fixed(int a, int b, int t, int n)
+{
+    return (a << 16) + (int32_t) (((int64_t) (b - a) << 16) * t / n) + 0x8000;
+}
+
 static void grad_region(unsigned char *data, int width, int height, int stride,
 	int rx, int ry, int rw, int rh,
 	unsigned int rgb0, unsigned int rgb1, unsigned int rgb2, unsigned int rgb3)
 {
+    /* a narrow mask has empty regions. */
+    if (rw <= 0 || rh <= 0)
+	return;
+    
     struct {
-	unsigned char r, g, b;
+	int r, g, b;
     } rgb[4] = {
-	{ rgb0 >> 16, rgb0 >> 8, rgb0 >> 0 },
-	{ rgb1 >> 16, rgb1 >> 8, rgb1 >> 0 },
-	{ rgb2 >> 16, rgb2 >> 8, rgb2 >> 0 },
-	{ rgb3 >> 16, rgb3 >> 8, rgb3 >> 0 },
-    }, top[rw], bot[rw];
-    
-    for (int dx = 0; dx < rw; dx++) {
-	top[dx].r = (rgb[0].r * (rw - dx) + rgb[1].r * dx) / rw;
-	top[dx].g = (rgb[0].g * (rw - dx) + rgb[1].g * dx) / rw;
-	top[dx].b = (rgb[0].b * (rw - dx) + rgb[1].b * dx) / rw;
+	{ (rgb0 >> 16) & 0xff, (rgb0 >> 8) & 0xff, rgb0 & 0xff },
+	{ (rgb1 >> 16) & 0xff, (rgb1 >> 8) & 0xff, rgb1 & 0xff },
+	{ (rgb2 >> 16) & 0xff, (rgb2 >> 8) & 0xff, rgb2 & 0xff },
+	{ (rgb3 >> 16) & 0xff, (rgb3 >> 8) & 0xff, rgb3 & 0xff },
+    };
+    
+    /* bilinear is linear along each row, so only the ends of rows are
+     * interpolated vertically, and the rest is stepped.
+     */
+    for (int dy = 0; dy < rh; dy++) {
+	int32_t lr = lerp_fixed(rgb[0].r, rgb[2].r, dy, rh);
+	int32_t lg = lerp_fixed(rgb[0].g, rgb[2].g, dy, rh);
+	int32_t lb = lerp_fixed(rgb[0].b, rgb[2].b, dy, rh);
+	int32_t rr = lerp_fixed(rgb[1].r, rgb[3].r, dy, rh);
+	int32_t rg = lerp_fixed(rgb[1].g, rgb[3].g, dy, rh);
+	int32_t rb = lerp_fixed(rgb[1].b, rgb[3].b, dy, rh);
+	
+	grad_row((uint32_t *) (data + stride * (ry + dy) + rx * 4), rw,
+		lr, lg, lb, (rr - lr) / rw, (rg - lg) / rw, (rb - lb) / rw);
     }
+}
+
+/* blurs the pixels in place. */
+static void mask_pixels(unsigned char *data, int width, int height, int stride)
+{
+    int nr_x, nr_y;
+    nr_x = width / 32;
+    nr_y = height / 32;
+    if (nr_x < 2)
+	nr_x = 2;
+    if (nr_y < 2)
+	nr_y = 2;
+    int xs[nr_x + 1], ys[nr_y + 1];
+    for (int i = 0; i < nr_x; i++)
+	xs[i] = width * i / nr_x;
+    for (int i = 0; i < nr_y; i++)
+	ys[i] = height * i / nr_y;
+    xs[nr_x] = width;
+    ys[nr_y] = height;
     
-    for (int dx = 0; dx < rw; dx++) {
-	bot[dx].r = (rgb[2].r * (rw - dx) + rgb[3].r * dx) / rw;
-	bot[dx].g = (rgb[2].g * (rw - dx) + rgb[3].g * dx) / rw;
-	bot[dx].b = (rgb[2].b * (rw - dx) + rgb[3].b * dx) / rw;
+    uint32_t *sat = make_sat(data, width, height, stride);
+    unsigned int rgb[nr_y + 1][nr_x + 1];
+    for (int j = 0; j <= nr_y; j++) {
+	for (int i = 0; i <= nr_x; i++)
+	    rgb[j][i] = avg_color(sat, width, height, xs[i], ys[j]);
     }
+    g_free(sat);
     
-    for (int dy = 0; dy < rh; dy++) {
-	for (int dx = 0; dx < rw; dx++) {
-	    unsigned char mid_r, mid_g, mid_b;
-	    mid_r = (top[dx].r * (rh - dy) + bot[dx].r * dy) / rh;
-	    mid_g = (top[dx].g * (rh - dy) + bot[dx].g * dy) / rh;
-	    mid_b = (top[dx].b * (rh - dy) + bot[dx].b * dy) / rh;
-	    
-	    uint32_t mid_rgb = mid_r << 16 | mid_g << 8 | mid_b;
-	    *(uint32_t *) (data + stride * (ry + dy) + (rx + dx) * 4) = mid_rgb;
+    for (int j = 0; j < nr_y; j++) {
+	for (int i = 0; i < nr_x; i++) {
+	    grad_region(data, width, height, stride,
+		    xs[i], ys[j], xs[i + 1] - xs[i], ys[j + 1] - ys[j],
+		    rgb[j][i], rgb[j][i + 1], rgb[j + 1][i], rgb[j + 1][i + 1]);
 	}
     }
 }
 
-void mask_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
+/* returns the pixels of the target under (x, y, width, height) if they can
+ * be modified in place: the target is a RGB24 image, the matrix is a plain
+ * integer translation, and the area is inside both the target and the clip.
+ */
+static unsigned char *direct_pixels(cairo_t *cr, int x, int y, int width, int height, int *stride)
+{
+    cairo_surface_t *target = cairo_get_target(cr);
+    if (cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE)
+	return NULL;
+    if (cairo_image_surface_get_format(target) != CAIRO_FORMAT_RGB24)
+	return NULL;
+    
+    cairo_matrix_t mat;
+    cairo_get_matrix(cr, &mat);
+    double dev_x, dev_y;
+    cairo_surface_get_device_offset(target, &dev_x, &dev_y);
+    double tx = mat.x0 + dev_x, ty = mat.y0 + dev_y;
+    if (mat.xx != 1 || mat.yy != 1 || mat.xy != 0 || mat.yx != 0 || tx != floor(tx) || ty != floor(ty))
+	return NULL;
+    
+    cairo_rectangle_int_t area = { x, y, width, height };
+    
+    gboolean clipped = TRUE;
+    cairo_rectangle_list_t *list = cairo_copy_clip_rectangle_list(cr);
+    if (list->status == CAIRO_STATUS_SUCCESS) {
+	for (int i = 0; i < list->num_rectangles; i++) {
+	    cairo_rectangle_t *r = &list->rectangles[i];
+	    cairo_rectangle_int_t clip;
+	    bbox_from_corners(&clip, ceil(r->x), ceil(r->y), floor(r->x + r->width), floor(r->y + r->height));
+	    if (bbox_contains(&clip, &area)) {
+		clipped = FALSE;
+		break;
+	    }
+	}
+    }
+    cairo_rectangle_list_destroy(list);
+    if (clipped)
+	return NULL;
+    
+    area.x += tx;
+    area.y += ty;
+    cairo_rectangle_int_t bounds = {
+	0, 0, cairo_image_surface_get_width(target), cairo_image_surface_get_height(target),
+    };
+    if (!bbox_contains(&bounds, &area))
+	return NULL;
+    
+    cairo_surface_flush(target);
+    *stride = cairo_image_surface_get_stride(target);
+    return cairo_image_surface_get_data(target) + *stride * area.y + area.x * 4;
+}
+
+void mask_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected)
 {
     int x = parts->x;
     int y = parts->y;
@@ -168,9 +366,23 @@ void mask_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
 	y += height;
 	height = -height;
     }
-
-    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, width);
-    unsigned char *data = g_malloc(stride * height);
+    
+    int stride;
+    unsigned char *data = direct_pixels(cr, x, y, width, height, &stride);
+    if (data != NULL) {
+	mask_pixels(data, width, height, stride);
+	
+	cairo_surface_t *target = cairo_get_target(cr);
+	double dx = x, dy = y;
+	cairo_user_to_device(cr, &dx, &dy);
+	cairo_surface_mark_dirty_rectangle(target, dx, dy, width, height);
+	return;
+    }
+    
+    /* otherwise, copy the pixels out and back. */
+    
+    stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, width);
+    data = g_malloc(stride * height);
     
     cairo_pattern_t *pat = cairo_pattern_create_for_surface(cairo_get_target(cr));
     cairo_matrix_t mat;
@@ -187,34 +399,7 @@ void mask_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
     
     cairo_pattern_destroy(pat);
     
-    int nr_x, nr_y;
-    nr_x = width / 32;
-    nr_y = height / 32;
-    if (nr_x < 2)
-	nr_x = 2;
-    if (nr_y < 2)
-	nr_y = 2;
-    int xs[nr_x + 1], ys[nr_y + 1];
-    for (int i = 0; i < nr_x; i++)
-	xs[i] = width * i / nr_x;
-    for (int i = 0; i < nr_y; i++)
-	ys[i] = height * i / nr_y;
-    xs[nr_x] = width;
-    ys[nr_y] = height;
-    
-    unsigned int rgb[nr_y + 1][nr_x + 1];
-    for (int j = 0; j <= nr_y; j++) {
-	for (int i = 0; i <= nr_x; i++)
-	    rgb[j][i] = avg_color(data, width, height, stride, xs[i], ys[j]);
-    }
-    
-    for (int j = 0; j < nr_y; j++) {
-	for (int i = 0; i < nr_x; i++) {
-	    grad_region(data, width, height, stride,
-		    xs[i], ys[j], xs[i + 1] - xs[i], ys[j + 1] - ys[j],
-		    rgb[j][i], rgb[j][i + 1], rgb[j + 1][i], rgb[j + 1][i + 1]);
-	}
-    }
+    mask_pixels(data, width, height, stride);
     
     cairo_surface_t *cs2 = cairo_image_surface_create_for_data(data, CAIRO_FORMAT_RGB24, width, height, stride);
     cairo_pattern_t *pat2 = cairo_pattern_create_for_surface(cs2);
@@ -242,7 +427,7 @@ void mask_draw_handle(struct parts_t *parts, cairo_t *cr)
     handle_draw(handles, HANDLE_NR, cr);
 }
 
-gboolean mask_select(struct parts_t *parts, int x, int y, gboolean selected)
+gboolean mask_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected)
 {
     struct handle_t handles[HANDLE_NR];
     make_handle_geoms(parts, handles);
@@ -251,13 +436,13 @@ gboolean mask_select(struct parts_t *parts, int x, int y, gboolean selected)
 	for (int i = 0; i < HANDLE_NR; i++) {
 	    if (x >= handles[i].x && x < handles[i].x + handles[i].width
 		    && y >= handles[i].y && y < handles[i].y + handles[i].height) {
-		beg_x = x;
-		beg_y = y;
-		orig_x = parts->x;
-		orig_y = parts->y;
-		orig_w = parts->width;
-		orig_h = parts->height;
-		dragging_handle = i;
+		drag->beg_x = x;
+		drag->beg_y = y;
+		drag->orig_x = parts->x;
+		drag->orig_y = parts->y;
+		drag->orig_w = parts->width;
+		drag->orig_h = parts->height;
+		drag->handle = i;
 		return TRUE;
 	    }
 	}
@@ -281,63 +466,68 @@ gboolean mask_select(struct parts_t *parts, int x, int y, gboolean selected)
 	y2 = t;
     }
     
-    beg_x = x;
-    beg_y = y;
-    orig_x = parts->x;
-    orig_y = parts->y;
-    dragging_handle = -1;
+    drag->beg_x = x;
+    drag->beg_y = y;
+    drag->orig_x = parts->x;
+    drag->orig_y = parts->y;
+    drag->handle = -1;
     
     return x >= x1 && x < x2 && y >= y1 && y < y2;
 }
 
-void mask_drag_step(struct parts_t *p, int x, int y)
+void mask_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y)
 {
-    int dx = x - beg_x;
-    int dy = y - beg_y;
+    int dx = x - drag->beg_x;
+    int dy = y - drag->beg_y;
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_LEFT:
     case HANDLE_LEFT:
     case HANDLE_BOTTOM_LEFT:
-	p->x = orig_x + dx;
-	p->width = orig_w - dx;
+	p->x = drag->orig_x + dx;
+	p->width = drag->orig_w - dx;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_RIGHT:
     case HANDLE_RIGHT:
     case HANDLE_BOTTOM_RIGHT:
-	p->width = orig_w + dx;
+	p->width = drag->orig_w + dx;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_LEFT:
     case HANDLE_TOP:
     case HANDLE_TOP_RIGHT:
-	p->y = orig_y + dy;
-	p->height = orig_h - dy;
+	p->y = drag->orig_y + dy;
+	p->height = drag->orig_h - dy;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_BOTTOM_LEFT:
     case HANDLE_BOTTOM:
     case HANDLE_BOTTOM_RIGHT:
-	p->height = orig_h + dy;
+	p->height = drag->orig_h + dy;
     }
     
-    if (dragging_handle == -1) {
-	p->x = orig_x + dx;
-	p->y = orig_y + dy;
+    if (drag->handle == -1) {
+	p->x = drag->orig_x + dx;
+	p->y = drag->orig_y + dy;
     }
 }
 
-void mask_drag_fini(struct parts_t *parts, int x, int y)
+void mask_drag_fini(struct parts_t *parts, struct drag_t *drag, int x, int y)
+{
+}
+
+void mask_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect)
 {
+    bbox_from_corners(rect, parts->x, parts->y, parts->x + parts->width, parts->y + parts->height);
 }
 
-struct parts_t *mask_create(int x, int y)
+struct parts_t *mask_create(struct render_ctx_t *ctx, int x, int y)
 {
-    struct parts_t *p = parts_alloc();
+    struct parts_t *p = parts_alloc(ctx);
     
     p->type = PARTS_MASK;
     p->x = x;
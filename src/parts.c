@@ -0,0 +1,597 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gtk/gtk.h>
+
+#include "common.h"
+#include "shapes.h"
+#include "bbox.h"
+
+/**** render context ****/
+
+#define INITIAL_COLOR		"red"
+#define INITIAL_FONT		"Sans Bold 24"
+#define INITIAL_THICKNESS	7
+
+struct render_ctx_t *render_ctx_new(void)
+{
+    struct render_ctx_t *ctx = g_new0(struct render_ctx_t, 1);
+    
+    ctx->font_map = pango_cairo_font_map_new();
+    ctx->pango = pango_font_map_create_context(ctx->font_map);
+    gdk_rgba_parse(&ctx->color, INITIAL_COLOR);
+    ctx->fontname = g_strdup(INITIAL_FONT);
+    ctx->thickness = INITIAL_THICKNESS;
+    
+    return ctx;
+}
+
+void render_ctx_free(struct render_ctx_t *ctx)
+{
+    g_free(ctx->focus.preedit_str);
+    if (ctx->focus.preedit_attrs != NULL)
+	pango_attr_list_unref(ctx->focus.preedit_attrs);
+    g_free(ctx->fontname);
+    g_object_unref(ctx->pango);
+    g_object_unref(ctx->font_map);
+    g_free(ctx);
+}
+
+/**** parts ****/
+
+/* parts are cut out of chunks, so that those of a history lie close
+ * together, and that a copy seldom calls malloc. freed parts are kept
+ * for reuse, since parts are freed on worker threads too.
+ */
+#define PARTS_CHUNK	64
+
+struct free_parts_t {
+    struct free_parts_t *next;
+};
+
+static struct free_parts_t *free_parts = NULL;
+G_LOCK_DEFINE_STATIC(free_parts);
+
+static struct parts_t *parts_new(void)
+{
+    G_LOCK(free_parts);
+    if (free_parts == NULL) {
+	struct parts_t *chunk = g_new(struct parts_t, PARTS_CHUNK);
+	for (int i = PARTS_CHUNK - 1; i >= 0; i--) {
+	    struct free_parts_t *f = (struct free_parts_t *) &chunk[i];
+	    f->next = free_parts;
+	    free_parts = f;
+	}
+    }
+    struct parts_t *p = (struct parts_t *) free_parts;
+    free_parts = free_parts->next;
+    G_UNLOCK(free_parts);
+    
+    memset(p, 0, sizeof *p);
+    return p;
+}
+
+static void parts_delete(struct parts_t *p)
+{
+    struct free_parts_t *f = (struct free_parts_t *) p;
+    G_LOCK(free_parts);
+    f->next = free_parts;
+    free_parts = f;
+    G_UNLOCK(free_parts);
+}
+
+/* new parts are of the color, font and thickness in ctx. */
+struct parts_t *parts_alloc(struct render_ctx_t *ctx)
+{
+    struct parts_t *p = parts_new();
+    
+    p->ref_count = 1;
+    p->fg = ctx->color;
+    p->fontname = g_intern_string(ctx->fontname);
+    p->thickness = ctx->thickness;
+    
+    return p;
+}
+
+/* a copy to be changed. */
+struct parts_t *parts_dup(struct parts_t *orig)
+{
+    struct parts_t *p = parts_new();
+    *p = *orig;
+    p->ref_count = 1;
+    if (p->text != NULL)
+	p->text = g_strdup(p->text);
+    if (p->text_cache != NULL)
+	text_cache_ref(p->text_cache);
+    if (p->surface != NULL)
+	cairo_surface_reference(p->surface);	// 画像自体は共有
+    return p;
+}
+
+struct parts_t *parts_ref(struct parts_t *p)
+{
+    g_atomic_int_inc(&p->ref_count);
+    return p;
+}
+
+/* snapshots are freed on worker threads, so the count is atomic. */
+void parts_unref(struct parts_t *p)
+{
+    if (!g_atomic_int_dec_and_test(&p->ref_count))
+	return;
+    g_free(p->text);
+    if (p->text_cache != NULL)
+	text_cache_unref(p->text_cache);
+    if (p->surface != NULL)
+	cairo_surface_destroy(p->surface);
+    parts_delete(p);
+}
+
+/**** history ****/
+
+int history_index_of(struct history_t *hp, struct parts_t *p)
+{
+    for (int i = 0; i < hp->nparts; i++) {
+	if (hp->parts[i] == p)
+	    return i;
+    }
+    return -1;
+}
+
+/* hp takes over the reference of pp. */
+void history_insert_parts(struct history_t *hp, struct parts_t *pp, int index)
+{
+    if (hp->nparts == hp->size) {
+	hp->size = hp->size != 0 ? hp->size * 2 : 16;
+	hp->parts = g_renew(struct parts_t *, hp->parts, hp->size);
+    }
+    memmove(&hp->parts[index + 1], &hp->parts[index], (hp->nparts - index) * sizeof hp->parts[0]);
+    hp->parts[index] = pp;
+    hp->nparts++;
+}
+
+/* the reference hp had is returned. */
+struct parts_t *history_remove_parts(struct history_t *hp, int index)
+{
+    struct parts_t *pp = hp->parts[index];
+    hp->nparts--;
+    memmove(&hp->parts[index], &hp->parts[index + 1], (hp->nparts - index) * sizeof hp->parts[0]);
+    
+    if (hp->selp == pp)
+	hp->selp = NULL;
+    
+    return pp;
+}
+
+void history_append_parts(struct history_t *hp, struct parts_t *pp)
+{
+    history_insert_parts(hp, pp, hp->nparts);
+}
+
+/* a shared part is replaced with a copy of its own before it is changed,
+ * so the others keep seeing it as it was.
+ */
+struct parts_t *history_writable_parts(struct history_t *hp, struct parts_t *p)
+{
+    if (g_atomic_int_get(&p->ref_count) == 1)
+	return p;
+    
+    int i = history_index_of(hp, p);
+    if (i < 0) {
+	fprintf(stderr, "parts not in history.\n");
+	exit(1);
+    }
+    
+    struct parts_t *q = parts_dup(p);
+    hp->parts[i] = q;
+    if (hp->selp == p)
+	hp->selp = q;
+    if (hp->ctx->focus.parts == p)
+	hp->ctx->focus.parts = q;
+    parts_unref(p);
+    
+    return q;
+}
+
+/* a snapshot, which shares the parts with orig. */
+struct history_t *history_dup(struct history_t *orig)
+{
+    struct history_t *hp = g_new0(struct history_t, 1);
+    
+    hp->ctx = orig->ctx;
+    hp->parts = g_new(struct parts_t *, orig->nparts);
+    hp->nparts = hp->size = orig->nparts;
+    for (int i = 0; i < hp->nparts; i++)
+	hp->parts[i] = parts_ref(orig->parts[i]);
+    hp->selp = orig->selp;
+    
+    return hp;
+}
+
+void history_free(struct history_t *hp)
+{
+    for (int i = 0; i < hp->nparts; i++)
+	parts_unref(hp->parts[i]);
+    g_free(hp->parts);
+    g_free(hp);
+}
+
+/**** document ****/
+
+#define UNDO_BUDGET	(64 << 20)
+#define MERGE_WINDOW	G_USEC_PER_SEC
+
+/* roughly, the memory p takes. */
+static size_t parts_size(struct parts_t *p)
+{
+    size_t size = sizeof *p;
+    if (p->text != NULL)
+	size += strlen(p->text) + 1;
+    if (p->text_cache != NULL)
+	size += text_cache_size(p->text_cache);
+    return size;
+}
+
+static size_t change_size(struct change_t *c)
+{
+    return sizeof *c + (c->parts != NULL ? parts_size(c->parts) : 0);
+}
+
+/* frees c and the older ones. the parts deleted by them go here. */
+static void change_free_list(struct change_t *c)
+{
+    struct change_t *next;
+    for (; c != NULL; c = next) {
+	next = c->next;
+	if (c->parts != NULL)
+	    parts_unref(c->parts);
+	g_free(c);
+    }
+}
+
+/* drops the oldest steps until the rest fit in 3/4 of the budget, so
+ * that this isn't done at every step. the newest is always kept.
+ */
+static void history_trim(struct document_t *doc)
+{
+    if (doc->undo_budget == 0 || doc->undo_bytes <= doc->undo_budget)
+	return;
+    
+    size_t keep = doc->undo_budget / 4 * 3;
+    size_t bytes = 0;
+    int steps = 0;
+    struct change_t **cp;
+    for (cp = &doc->undoable; *cp != NULL; cp = &(*cp)->next) {
+	if (steps > 0 && bytes + (*cp)->size > keep)
+	    break;
+	bytes += (*cp)->size;
+	steps++;
+    }
+    change_free_list(*cp);
+    *cp = NULL;
+    
+    doc->undo_bytes = bytes;
+    doc->undo_steps = steps;
+}
+
+/* base is the image to be annotated. */
+struct document_t *document_new(struct render_ctx_t *ctx, struct parts_t *base)
+{
+    struct document_t *doc = g_new0(struct document_t, 1);
+    struct history_t *hist = g_new0(struct history_t, 1);
+    
+    hist->ctx = ctx;
+    history_append_parts(hist, base);
+    doc->hp = hist;
+    doc->undoable = NULL;
+    doc->redoable = NULL;
+    doc->undo_budget = UNDO_BUDGET;
+    
+    return doc;
+}
+
+/* pp is the part at from before the step, and takes the reference. */
+static void change_push(struct document_t *doc, struct parts_t *pp, int from, int to)
+{
+    struct change_t *c = g_new0(struct change_t, 1);
+    
+    c->parts = pp;
+    c->from = from;
+    c->to = to;
+    c->selp = doc->hp->selp;
+    c->size = change_size(c);
+    
+    c->next = doc->undoable;
+    doc->undoable = c;
+    doc->undo_steps++;
+    doc->undo_bytes += c->size;
+    
+    change_free_list(doc->redoable);
+    doc->redoable = NULL;
+    doc->redo_steps = 0;
+    
+    history_trim(doc);
+}
+
+/* records p as it is now, and returns the copy to be changed in place.
+ * if the last step was of the same kind to p and not long ago, p is
+ * changed in that step instead, so that holding a spin button or
+ * dragging in the color chooser makes one step.
+ */
+struct parts_t *history_change_parts(struct document_t *doc, struct parts_t *p, int kind)
+{
+    int i = history_index_of(doc->hp, p);
+    gint64 now = g_get_monotonic_time();
+    struct change_t *c = doc->undoable;
+    
+    if (kind != CHANGE_ANY && c != NULL && doc->redoable == NULL
+	    && c->kind == kind && c->from == i && c->to == i
+	    && now - c->time < MERGE_WINDOW) {
+	c->time = now;
+	return history_writable_parts(doc->hp, p);
+    }
+    
+    change_push(doc, parts_ref(p), i, i);
+    doc->undoable->kind = kind;
+    doc->undoable->time = now;
+    return history_writable_parts(doc->hp, p);
+}
+
+/* moves p to index. */
+void history_move_parts(struct document_t *doc, struct parts_t *p, int index)
+{
+    struct history_t *hp = doc->hp;
+    int i = history_index_of(hp, p);
+    change_push(doc, parts_ref(p), i, index);
+    
+    struct parts_t *selp = hp->selp;
+    history_insert_parts(hp, history_remove_parts(hp, i), index);
+    hp->selp = selp;
+}
+
+void history_delete_parts(struct document_t *doc, struct parts_t *p)
+{
+    int i = history_index_of(doc->hp, p);
+    change_push(doc, parts_ref(p), i, -1);
+    parts_unref(history_remove_parts(doc->hp, i));
+}
+
+/* appends a new part. */
+void history_add_parts(struct document_t *doc, struct parts_t *p)
+{
+    change_push(doc, NULL, -1, doc->hp->nparts);
+    history_append_parts(doc->hp, p);
+}
+
+/* brings back the state c recorded, and records the current one in c
+ * instead, so that applying it again goes the other way.
+ * the indices are right, since changes are applied in reverse order
+ * of how they were made.
+ */
+static void change_apply(struct history_t *hp, struct change_t *c)
+{
+    struct parts_t *cur = NULL;
+    struct parts_t *selp = hp->selp;
+    
+    if (c->to >= 0)
+	cur = history_remove_parts(hp, c->to);
+    if (c->from >= 0)
+	history_insert_parts(hp, c->parts, c->from);
+    hp->selp = c->selp;
+    
+    c->parts = cur;
+    int t = c->from;
+    c->from = c->to;
+    c->to = t;
+    c->selp = selp;
+    c->size = change_size(c);
+}
+
+void history_undo(struct document_t *doc)
+{
+    struct change_t *c = doc->undoable;
+    if (c == NULL) {
+	/* can't undo */
+	return;
+    }
+    doc->undoable = c->next;
+    doc->undo_steps--;
+    doc->undo_bytes -= c->size;
+    
+    change_apply(doc->hp, c);
+    
+    c->next = doc->redoable;
+    doc->redoable = c;
+    doc->redo_steps++;
+}
+
+void history_redo(struct document_t *doc)
+{
+    struct change_t *c = doc->redoable;
+    if (c == NULL) {
+	/* can't redo */
+	return;
+    }
+    doc->redoable = c->next;
+    doc->redo_steps--;
+    
+    change_apply(doc->hp, c);
+    
+    c->next = doc->undoable;
+    doc->undoable = c;
+    doc->undo_steps++;
+    doc->undo_bytes += c->size;
+}
+
+/****/
+
+static void base_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected)
+{
+    cairo_set_source_surface(cr, parts->surface, 0, 0);
+    cairo_paint(cr);
+}
+
+static gboolean base_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected)
+{
+    return TRUE;
+}
+
+static void base_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect)
+{
+    rect->x = 0;
+    rect->y = 0;
+    rect->width = parts->width;
+    rect->height = parts->height;
+}
+
+/****/
+
+static const struct {
+    void (*draw)(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected);
+    void (*draw_handle)(struct parts_t *parts, cairo_t *cr);
+    gboolean (*select)(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected);
+    void (*drag_step)(struct parts_t *parts, struct drag_t *drag, int x, int y);
+    void (*drag_fini)(struct parts_t *parts, struct drag_t *drag, int x, int y);
+    void (*get_bbox)(struct parts_t *parts, cairo_rectangle_int_t *rect);
+    void (*prepare)(struct render_ctx_t *ctx, struct parts_t *parts);
+} parts_ops[PARTS_NR] = {
+    { base_draw, NULL, base_select, NULL, NULL, base_get_bbox, NULL },
+    { arrow_draw, arrow_draw_handle, arrow_select, arrow_drag_step, arrow_drag_fini, arrow_get_bbox, NULL },
+    { text_draw, text_draw_handle, text_select, text_drag_step, text_drag_fini, text_get_bbox, text_prepare },
+    { rect_draw, rect_draw_handle, rect_select, rect_drag_step, rect_drag_fini, rect_get_bbox, NULL },
+    { mask_draw, mask_draw_handle, mask_select, mask_drag_step, mask_drag_fini, mask_get_bbox, NULL },
+};
+
+void call_draw(struct render_ctx_t *ctx, struct parts_t *p, cairo_t *cr, gboolean selected)
+{
+    if (p->type < 0 || p->type >= PARTS_NR) {
+	fprintf(stderr, "unknown parts type: %d.\n", p->type);
+	exit(1);
+    }
+    if (parts_ops[p->type].draw != NULL)
+	(*parts_ops[p->type].draw)(ctx, p, cr, selected);
+}
+
+void call_draw_handle(struct parts_t *p, cairo_t *cr)
+{
+    if (p->type < 0 || p->type >= PARTS_NR) {
+	fprintf(stderr, "unknown parts type: %d.\n", p->type);
+	exit(1);
+    }
+    if (parts_ops[p->type].draw_handle != NULL)
+	(*parts_ops[p->type].draw_handle)(p, cr);
+}
+
+gboolean call_select(struct parts_t *p, struct drag_t *drag, int x, int y, gboolean selected)
+{
+    if (p->type < 0 || p->type >= PARTS_NR) {
+	fprintf(stderr, "unknown parts type: %d.\n", p->type);
+	exit(1);
+    }
+    if (parts_ops[p->type].select != NULL)
+	return (*parts_ops[p->type].select)(p, drag, x, y, selected);
+    return FALSE;
+}
+
+void call_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y)
+{
+    if (p->type < 0 || p->type >= PARTS_NR) {
+	fprintf(stderr, "unknown parts type: %d.\n", p->type);
+	exit(1);
+    }
+    if (parts_ops[p->type].drag_step != NULL)
+	(*parts_ops[p->type].drag_step)(p, drag, x, y);
+}
+
+void call_drag_fini(struct parts_t *p, struct drag_t *drag, int x, int y)
+{
+    if (p->type < 0 || p->type >= PARTS_NR) {
+	fprintf(stderr, "unknown parts type: %d.\n", p->type);
+	exit(1);
+    }
+    if (parts_ops[p->type].drag_fini != NULL)
+	(*parts_ops[p->type].drag_fini)(p, drag, x, y);
+}
+
+void call_get_bbox(struct parts_t *p, cairo_rectangle_int_t *rect)
+{
+    if (p->type < 0 || p->type >= PARTS_NR) {
+	fprintf(stderr, "unknown parts type: %d.\n", p->type);
+	exit(1);
+    }
+    bbox_set_empty(rect);
+    if (parts_ops[p->type].get_bbox != NULL)
+	(*parts_ops[p->type].get_bbox)(p, rect);
+}
+
+/* makes the part ready to be drawn from threads other than the main one. */
+void call_prepare(struct render_ctx_t *ctx, struct parts_t *p)
+{
+    if (p->type < 0 || p->type >= PARTS_NR) {
+	fprintf(stderr, "unknown parts type: %d.\n", p->type);
+	exit(1);
+    }
+    if (parts_ops[p->type].prepare != NULL)
+	(*parts_ops[p->type].prepare)(ctx, p);
+}
+
+
+/**** drawing ****/
+
+/* draws the parts of hp from beg up to before end, skipping those entirely
+ * out of the clip.
+ */
+void draw_parts_range(struct history_t *hp, int beg, int end,
+	cairo_t *cr, gboolean show_selection)
+{
+    double x1, y1, x2, y2;
+    cairo_clip_extents(cr, &x1, &y1, &x2, &y2);
+    cairo_rectangle_int_t clip;
+    bbox_from_corners(&clip, floor(x1), floor(y1), ceil(x2), ceil(y2));
+    
+    for (int i = beg; i < end; i++) {
+	struct parts_t *lp = hp->parts[i];
+	cairo_rectangle_int_t rect;
+	call_get_bbox(lp, &rect);
+	if (!bbox_intersects(&clip, &rect))
+	    continue;
+	
+	cairo_save(cr);
+	call_draw(hp->ctx, lp, cr, show_selection && lp == hp->selp);
+	cairo_restore(cr);
+    }
+}
+
+void draw_parts(struct history_t *hp, cairo_t *cr, gboolean show_selection)
+{
+    draw_parts_range(hp, 0, hp->nparts, cr, show_selection);
+}
+
+void paint_range(cairo_t *cr, void *data)
+{
+    struct parts_range_t *range = data;
+    draw_parts_range(range->hp, range->beg, range->end, cr, FALSE);
+}
+
+/* paints all of the history given as data, for render_*(). */
+void paint_history(cairo_t *cr, void *data)
+{
+    draw_parts(data, cr, FALSE);
+}
+
@@ -0,0 +1,440 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <zlib.h>
+#include <gtk/gtk.h>
+
+#include "png.h"
+
+/* like pigz, each band is deflated on its own with the end of the band
+ * before it as the dictionary, and flushed to a byte boundary, so that
+ * the outputs put together make one zlib stream. the checksum is
+ * combined from those of the bands.
+ */
+
+#define BAND_SIZE (256 * 1024)	/* bytes of filtered data in a band, roughly */
+#define WINDOW_SIZE 32768
+
+struct band_t {
+    struct png_writer_t *w;
+    
+    /* input: nr_prefix rows of the band before, then nr_rows rows, of RGB. */
+    unsigned char *raw;
+    int nr_prefix, nr_rows;
+    gboolean last;
+    
+    /* output */
+    unsigned char *out;
+    size_t out_len;
+    uLong adler;
+    size_t filtered_len;
+    gboolean done;
+};
+
+struct png_writer_t {
+    int width, height, level;
+    png_write_func_t write;
+    void *closure;
+    
+    size_t row_bytes;
+    int band_rows, prefix_rows;
+    int rows_added;
+    struct band_t *cur;		/* being filled */
+    
+    GMutex lock;
+    GCond cond;
+    GQueue bands;		/* submitted and not written yet, in order */
+    guint max_bands;
+    
+    uLong adler;
+    gboolean failed;
+    int err;
+};
+
+/**** filters ****/
+
+static inline int paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+	return a;
+    if (pb <= pc)
+	return b;
+    return c;
+}
+
+static void filter_with(int type, const unsigned char *row, const unsigned char *prev, size_t n, unsigned char *out)
+{
+    out[0] = type;
+    out++;
+    
+    switch (type) {
+    case 0:
+	memcpy(out, row, n);
+	break;
+    case 1:
+	for (size_t i = 0; i < n; i++)
+	    out[i] = row[i] - (i >= 3 ? row[i - 3] : 0);
+	break;
+    case 2:
+	for (size_t i = 0; i < n; i++)
+	    out[i] = row[i] - prev[i];
+	break;
+    case 3:
+	for (size_t i = 0; i < n; i++)
+	    out[i] = row[i] - (((i >= 3 ? row[i - 3] : 0) + prev[i]) >> 1);
+	break;
+    case 4:
+	for (size_t i = 0; i < n; i++)
+	    out[i] = row[i] - paeth(i >= 3 ? row[i - 3] : 0, prev[i], i >= 3 ? prev[i - 3] : 0);
+	break;
+    }
+}
+
+static unsigned long filter_cost(const unsigned char *out, size_t n)
+{
+    unsigned long sum = 0;
+    for (size_t i = 1; i <= n; i++)
+	sum += abs((signed char) out[i]);
+    return sum;
+}
+
+/* filters a row into out, of n + 1 bytes. the choice depends only on the
+ * rows, so that a band can filter the end of the band before it again
+ * and get the same bytes.
+ */
+static void filter_row(int level, const unsigned char *row, const unsigned char *prev, size_t n,
+	unsigned char *out, unsigned char *work)
+{
+    if (level <= PNG_LEVEL_FASTEST) {
+	filter_with(1, row, prev, n, out);
+	return;
+    }
+    
+    /* the heuristic of the PNG spec: the least sum of absolute differences. */
+    unsigned long best = ULONG_MAX;
+    for (int type = 0; type < 5; type++) {
+	filter_with(type, row, prev, n, work);
+	unsigned long cost = filter_cost(work, n);
+	if (cost < best) {
+	    best = cost;
+	    memcpy(out, work, n + 1);
+	}
+    }
+}
+
+/**** bands ****/
+
+static void band_free(struct band_t *b)
+{
+    g_free(b->raw);
+    g_free(b->out);
+    g_free(b);
+}
+
+static void band_worker(gpointer data, gpointer user_data)
+{
+    struct band_t *b = data;
+    struct png_writer_t *w = b->w;
+    size_t n = w->row_bytes;
+    unsigned char *work = g_malloc(n + 1);
+    unsigned char *zeros = g_malloc0(n);
+    
+    /* the dictionary: the end of the band before, filtered again. */
+    unsigned char *dict = NULL;
+    size_t dict_len = 0;
+    if (b->nr_prefix > 0) {
+	dict = g_malloc((n + 1) * (b->nr_prefix - 1));
+	for (int i = 1; i < b->nr_prefix; i++)
+	    filter_row(w->level, b->raw + n * i, b->raw + n * (i - 1), n, dict + (n + 1) * (i - 1), work);
+	dict_len = (n + 1) * (b->nr_prefix - 1);
+    }
+    
+    size_t len = (n + 1) * b->nr_rows;
+    unsigned char *filtered = g_malloc(len);
+    for (int i = 0; i < b->nr_rows; i++) {
+	int r = b->nr_prefix + i;
+	const unsigned char *prev = r > 0 ? b->raw + n * (r - 1) : zeros;
+	filter_row(w->level, b->raw + n * r, prev, n, filtered + (n + 1) * i, work);
+    }
+    g_free(b->raw);
+    b->raw = NULL;
+    
+    z_stream z;
+    memset(&z, 0, sizeof z);
+    if (deflateInit2(&z, w->level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+	fprintf(stderr, "deflateInit2 failed.\n");
+	exit(1);
+    }
+    if (dict_len > 0) {
+	size_t off = dict_len > WINDOW_SIZE ? dict_len - WINDOW_SIZE : 0;
+	deflateSetDictionary(&z, dict + off, dict_len - off);
+    }
+    
+    size_t cap = deflateBound(&z, len) + 16;
+    b->out = g_malloc(cap);
+    z.next_in = filtered;
+    z.avail_in = len;
+    z.next_out = b->out;
+    z.avail_out = cap;
+    int flush = b->last ? Z_FINISH : Z_SYNC_FLUSH;
+    for (;;) {
+	int ret = deflate(&z, flush);
+	if (ret == Z_STREAM_END || (ret == Z_OK && z.avail_out > 0 && z.avail_in == 0 && flush == Z_SYNC_FLUSH))
+	    break;
+	if (ret != Z_OK && ret != Z_BUF_ERROR) {
+	    fprintf(stderr, "deflate failed.\n");
+	    exit(1);
+	}
+	/* out of room. */
+	size_t used = cap - z.avail_out;
+	cap *= 2;
+	b->out = g_realloc(b->out, cap);
+	z.next_out = b->out + used;
+	z.avail_out = cap - used;
+    }
+    b->out_len = cap - z.avail_out;
+    deflateEnd(&z);
+    
+    b->adler = adler32(adler32(0, NULL, 0), filtered, len);
+    b->filtered_len = len;
+    
+    g_free(filtered);
+    g_free(dict);
+    g_free(zeros);
+    g_free(work);
+    
+    g_mutex_lock(&w->lock);
+    b->done = TRUE;
+    g_cond_broadcast(&w->cond);
+    g_mutex_unlock(&w->lock);
+}
+
+static GThreadPool *get_pool(void)
+{
+    static GThreadPool *pool = NULL;
+    G_LOCK_DEFINE_STATIC(pool);
+    
+    G_LOCK(pool);
+    if (pool == NULL) {
+	GError *err = NULL;
+	pool = g_thread_pool_new(band_worker, NULL, g_get_num_processors(), FALSE, &err);
+	if (pool == NULL) {
+	    fprintf(stderr, "%s\n", err->message);
+	    exit(1);
+	}
+    }
+    G_UNLOCK(pool);
+    return pool;
+}
+
+/**** output ****/
+
+static void put_be32(unsigned char *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static void write_bytes(struct png_writer_t *w, const unsigned char *data, size_t len)
+{
+    if (w->failed || len == 0)
+	return;
+    if (!(*w->write)(w->closure, data, len)) {
+	w->failed = TRUE;
+	w->err = errno;
+    }
+}
+
+static void write_chunk(struct png_writer_t *w, const char *type, const unsigned char *data, size_t len)
+{
+    unsigned char buf[8];
+    
+    put_be32(buf, len);
+    memcpy(buf + 4, type, 4);
+    write_bytes(w, buf, 8);
+    write_bytes(w, data, len);
+    
+    uLong crc = crc32(0, (const Bytef *) type, 4);
+    if (len > 0)
+	crc = crc32(crc, data, len);
+    put_be32(buf, crc);
+    write_bytes(w, buf, 4);
+}
+
+/* writes out the finished bands at the head. waits for the head if there
+ * are more than max bands.
+ */
+static void write_bands(struct png_writer_t *w, guint max)
+{
+    for (;;) {
+	g_mutex_lock(&w->lock);
+	struct band_t *b = g_queue_peek_head(&w->bands);
+	if (b == NULL) {
+	    g_mutex_unlock(&w->lock);
+	    break;
+	}
+	if (!b->done && g_queue_get_length(&w->bands) <= max) {
+	    g_mutex_unlock(&w->lock);
+	    break;
+	}
+	while (!b->done)
+	    g_cond_wait(&w->cond, &w->lock);
+	g_queue_pop_head(&w->bands);
+	g_mutex_unlock(&w->lock);
+	
+	write_chunk(w, "IDAT", b->out, b->out_len);
+	w->adler = adler32_combine(w->adler, b->adler, b->filtered_len);
+	band_free(b);
+    }
+}
+
+static struct band_t *band_new(struct png_writer_t *w, struct band_t *before)
+{
+    struct band_t *b = g_new0(struct band_t, 1);
+    b->w = w;
+    b->raw = g_malloc(w->row_bytes * (w->prefix_rows + w->band_rows));
+    if (before != NULL) {
+	b->nr_prefix = MIN(w->prefix_rows, before->nr_rows);
+	memcpy(b->raw,
+		before->raw + w->row_bytes * (before->nr_prefix + before->nr_rows - b->nr_prefix),
+		w->row_bytes * b->nr_prefix);
+    }
+    return b;
+}
+
+static void submit_band(struct png_writer_t *w)
+{
+    struct band_t *b = w->cur;
+    b->last = w->rows_added == w->height;
+    w->cur = b->last ? NULL : band_new(w, b);
+    
+    g_mutex_lock(&w->lock);
+    g_queue_push_tail(&w->bands, b);
+    g_mutex_unlock(&w->lock);
+    g_thread_pool_push(get_pool(), b, NULL);
+    
+    write_bands(w, w->max_bands);
+}
+
+/**** API ****/
+
+/* level is of zlib, 1 to 9. */
+struct png_writer_t *png_writer_new(int width, int height, int level, png_write_func_t write, void *closure)
+{
+    struct png_writer_t *w = g_new0(struct png_writer_t, 1);
+    
+    w->width = width;
+    w->height = height;
+    w->level = CLAMP(level, 1, 9);
+    w->write = write;
+    w->closure = closure;
+    w->row_bytes = (size_t) width * 3;
+    /* a band has to hold the dictionary of the next one. */
+    w->prefix_rows = (WINDOW_SIZE + w->row_bytes) / (w->row_bytes + 1) + 1;
+    w->band_rows = MAX(BAND_SIZE / (w->row_bytes + 1), (size_t) w->prefix_rows);
+    w->max_bands = g_get_num_processors() * 2;
+    g_mutex_init(&w->lock);
+    g_cond_init(&w->cond);
+    g_queue_init(&w->bands);
+    w->adler = adler32(0, NULL, 0);
+    w->cur = band_new(w, NULL);
+    
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    write_bytes(w, signature, sizeof signature);
+    
+    unsigned char ihdr[13];
+    put_be32(ihdr, width);
+    put_be32(ihdr + 4, height);
+    ihdr[8] = 8;	/* bit depth */
+    ihdr[9] = 2;	/* RGB */
+    ihdr[10] = 0;	/* deflate */
+    ihdr[11] = 0;	/* adaptive filtering */
+    ihdr[12] = 0;	/* no interlace */
+    write_chunk(w, "IHDR", ihdr, sizeof ihdr);
+    
+    /* zlib header */
+    unsigned char zhdr[2];
+    zhdr[0] = 0x78;	/* deflate, 32K window */
+    zhdr[1] = (w->level == 1 ? 0 : w->level < 6 ? 1 : w->level == 6 ? 2 : 3) << 6;
+    zhdr[1] += (31 - (zhdr[0] * 256 + zhdr[1]) % 31) % 31;
+    write_chunk(w, "IDAT", zhdr, sizeof zhdr);
+    
+    return w;
+}
+
+/* adds rows of RGB24 data from the top. */
+gboolean png_writer_add_rows(struct png_writer_t *w, const unsigned char *data, int stride, int nrows)
+{
+    for (int y = 0; y < nrows && w->rows_added < w->height; y++) {
+	struct band_t *b = w->cur;
+	const uint32_t *sp = (const uint32_t *) (data + stride * y);
+	unsigned char *dp = b->raw + w->row_bytes * (b->nr_prefix + b->nr_rows);
+	for (int x = 0; x < w->width; x++) {
+	    uint32_t rgb = *sp++;
+	    *dp++ = rgb >> 16;
+	    *dp++ = rgb >> 8;
+	    *dp++ = rgb;
+	}
+	b->nr_rows++;
+	w->rows_added++;
+	
+	if (b->nr_rows == w->band_rows || w->rows_added == w->height)
+	    submit_band(w);
+    }
+    
+    return !w->failed;
+}
+
+/* writes the rest, and frees w. all the rows should have been added. */
+gboolean png_writer_finish(struct png_writer_t *w)
+{
+    write_bands(w, 0);
+    
+    if (w->rows_added < w->height) {
+	w->failed = TRUE;
+	w->err = EINVAL;
+    }
+    
+    unsigned char buf[4];
+    put_be32(buf, w->adler);
+    write_chunk(w, "IDAT", buf, sizeof buf);
+    write_chunk(w, "IEND", NULL, 0);
+    
+    gboolean ok = !w->failed;
+    int err = w->err;
+    
+    if (w->cur != NULL)
+	band_free(w->cur);
+    g_cond_clear(&w->cond);
+    g_mutex_clear(&w->lock);
+    g_free(w);
+    
+    if (!ok)
+	errno = err;
+    return ok;
+}
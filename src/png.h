@@ -0,0 +1,37 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PNG_H__INCLUDED
+#define PNG_H__INCLUDED
+
+/* a PNG writer which deflates bands of rows on several threads at once.
+ * rows are given as RGB24 and written as 8bit RGB.
+ */
+
+#define PNG_LEVEL_FASTEST 1
+#define PNG_LEVEL_DEFAULT 6
+#define PNG_LEVEL_SMALLEST 9
+
+/* returns FALSE with errno set on failure. */
+typedef gboolean (*png_write_func_t)(void *closure, const unsigned char *data, size_t length);
+
+struct png_writer_t;
+
+struct png_writer_t *png_writer_new(int width, int height, int level, png_write_func_t write, void *closure);
+gboolean png_writer_add_rows(struct png_writer_t *w, const unsigned char *data, int stride, int nrows);
+gboolean png_writer_finish(struct png_writer_t *w);
+
+#endif	/* ifndef PNG_H__INCLUDED */
@@ -22,8 +22,8 @@
 #include "common.h"
 #include "shapes.h"
 #include "handle.h"
-#include "settings.h"
-#include "tcos.h"
+#include "bbox.h"
+#include "shadow.h"
 
 enum {
     HANDLE_TOP_LEFT,
@@ -38,10 +38,6 @@ enum {
     HANDLE_NR
 };
 
-static int beg_x = 0, beg_y = 0;
-static int orig_x = 0, orig_y = 0, orig_w = 0, orig_h = 0;
-static int dragging_handle = -1;
-
 static void make_handle_geoms(struct parts_t *p, struct handle_t *bufp)
 {
     struct handle_t *bp = bufp;
@@ -81,22 +77,10 @@ static void make_handle_geoms(struct parts_t *p, struct handle_t *bufp)
     handle_calc_geom(bufp, HANDLE_NR);
 }
 
-void rect_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
+void rect_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected)
 {
-#define DIFF 4.0
-
-    for (int i = 0; i < TCOS_NR; i++) {
-	int dx = DIFF * tcos(i) + DIFF / 2;
-	int dy = DIFF * tsin(i) + DIFF / 2;
-	cairo_save(cr);
-	cairo_set_line_width(cr, parts->thickness);
-	cairo_set_source_rgba(cr, 0.0, 0.0, 0.0, 0.05);
-	cairo_rectangle(cr, parts->x + dx, parts->y + dy, parts->width, parts->height);
-	cairo_stroke(cr);
-	cairo_restore(cr);
-    }
-
-#undef DIFF
+    shadow_draw_rect_frame(cr, &shadow_default,
+	    parts->x, parts->y, parts->width, parts->height, parts->thickness);
 
     cairo_set_line_width(cr, parts->thickness);
     cairo_set_source_rgba(cr, parts->fg.red, parts->fg.green, parts->fg.blue, 1);
@@ -111,7 +95,7 @@ void rect_draw_handle(struct parts_t *parts, cairo_t *cr)
     handle_draw(handles, HANDLE_NR, cr);
 }
 
-gboolean rect_select(struct parts_t *parts, int x, int y, gboolean selected)
+gboolean rect_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected)
 {
     struct handle_t handles[HANDLE_NR];
     make_handle_geoms(parts, handles);
@@ -120,13 +104,13 @@ gboolean rect_select(struct parts_t *parts, int x, int y, gboolean selected)
 	for (int i = 0; i < HANDLE_NR; i++) {
 	    if (x >= handles[i].x && x < handles[i].x + handles[i].width
 		    && y >= handles[i].y && y < handles[i].y + handles[i].height) {
-		beg_x = x;
-		beg_y = y;
-		orig_x = parts->x;
-		orig_y = parts->y;
-		orig_w = parts->width;
-		orig_h = parts->height;
-		dragging_handle = i;
+		drag->beg_x = x;
+		drag->beg_y = y;
+		drag->orig_x = parts->x;
+		drag->orig_y = parts->y;
+		drag->orig_w = parts->width;
+		drag->orig_h = parts->height;
+		drag->handle = i;
 		return TRUE;
 	    }
 	}
@@ -150,11 +134,11 @@ gboolean rect_select(struct parts_t *parts, int x, int y, gboolean selected)
 	y2 = t;
     }
     
-    beg_x = x;
-    beg_y = y;
-    orig_x = parts->x;
-    orig_y = parts->y;
-    dragging_handle = -1;
+    drag->beg_x = x;
+    drag->beg_y = y;
+    drag->orig_x = parts->x;
+    drag->orig_y = parts->y;
+    drag->handle = -1;
     
     if (x >= x1 && x < x2 && y >= y1 - parts->thickness / 2 && y < y1 + parts->thickness)
 	return TRUE;
@@ -167,54 +151,61 @@ gboolean rect_select(struct parts_t *parts, int x, int y, gboolean selected)
     return FALSE;
 }
 
-void rect_drag_step(struct parts_t *p, int x, int y)
+void rect_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y)
 {
-    int dx = x - beg_x;
-    int dy = y - beg_y;
+    int dx = x - drag->beg_x;
+    int dy = y - drag->beg_y;
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_LEFT:
     case HANDLE_LEFT:
     case HANDLE_BOTTOM_LEFT:
-	p->x = orig_x + dx;
-	p->width = orig_w - dx;
+	p->x = drag->orig_x + dx;
+	p->width = drag->orig_w - dx;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_RIGHT:
     case HANDLE_RIGHT:
     case HANDLE_BOTTOM_RIGHT:
-	p->width = orig_w + dx;
+	p->width = drag->orig_w + dx;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_LEFT:
     case HANDLE_TOP:
     case HANDLE_TOP_RIGHT:
-	p->y = orig_y + dy;
-	p->height = orig_h - dy;
+	p->y = drag->orig_y + dy;
+	p->height = drag->orig_h - dy;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_BOTTOM_LEFT:
     case HANDLE_BOTTOM:
     case HANDLE_BOTTOM_RIGHT:
-	p->height = orig_h + dy;
+	p->height = drag->orig_h + dy;
     }
     
-    if (dragging_handle == -1) {
-	p->x = orig_x + dx;
-	p->y = orig_y + dy;
+    if (drag->handle == -1) {
+	p->x = drag->orig_x + dx;
+	p->y = drag->orig_y + dy;
     }
 }
 
-void rect_drag_fini(struct parts_t *parts, int x, int y)
+void rect_drag_fini(struct parts_t *parts, struct drag_t *drag, int x, int y)
+{
+}
+
+void rect_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect)
 {
+    bbox_from_corners(rect, parts->x, parts->y, parts->x + parts->width, parts->y + parts->height);
+    /* the stroke sticks out by half of its width. */
+    bbox_inflate(rect, (parts->thickness + 1) / 2 + shadow_extent(&shadow_default));
 }
 
-struct parts_t *rect_create(int x, int y)
+struct parts_t *rect_create(struct render_ctx_t *ctx, int x, int y)
 {
-    struct parts_t *p = parts_alloc();
+    struct parts_t *p = parts_alloc(ctx);
     
     p->type = PARTS_RECT;
     p->x = x;
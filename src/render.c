@@ -0,0 +1,428 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <gtk/gtk.h>
+
+#include "common.h"
+#include "bbox.h"
+#include "png.h"
+#include "render.h"
+
+#define TILE_SIZE 256
+
+struct render_t {
+    cairo_surface_t *surface;
+    int x, y;			/* of the surface on the canvas */
+    int width, height;
+    int tiles_x, tiles_y;
+    guint8 *dirty;		/* tiles_x * tiles_y */
+};
+
+struct render_t *render_new(int width, int height)
+{
+    struct render_t *r = g_new0(struct render_t, 1);
+    
+    r->surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
+    r->width = width;
+    r->height = height;
+    r->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    r->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    r->dirty = g_malloc(r->tiles_x * r->tiles_y);
+    memset(r->dirty, 1, r->tiles_x * r->tiles_y);
+    
+    return r;
+}
+
+void render_free(struct render_t *r)
+{
+    cairo_surface_destroy(r->surface);
+    g_free(r->dirty);
+    g_free(r);
+}
+
+cairo_surface_t *render_get_surface(struct render_t *r)
+{
+    return r->surface;
+}
+
+/* the range of tiles over rect, clipped to the canvas. FALSE if none. */
+static gboolean tile_range(struct render_t *r, const cairo_rectangle_int_t *rect,
+	int *tx1, int *ty1, int *tx2, int *ty2)
+{
+    if (rect == NULL) {
+	*tx1 = *ty1 = 0;
+	*tx2 = r->tiles_x;
+	*ty2 = r->tiles_y;
+	return r->tiles_x > 0 && r->tiles_y > 0;
+    }
+    if (bbox_is_empty(rect))
+	return FALSE;
+    
+    *tx1 = MAX(rect->x, 0) / TILE_SIZE;
+    *ty1 = MAX(rect->y, 0) / TILE_SIZE;
+    *tx2 = MIN((MAX(rect->x + rect->width, 0) + TILE_SIZE - 1) / TILE_SIZE, r->tiles_x);
+    *ty2 = MIN((MAX(rect->y + rect->height, 0) + TILE_SIZE - 1) / TILE_SIZE, r->tiles_y);
+    return *tx1 < *tx2 && *ty1 < *ty2;
+}
+
+/* rect is NULL for all of the canvas. */
+void render_invalidate(struct render_t *r, const cairo_rectangle_int_t *rect)
+{
+    int tx1, ty1, tx2, ty2;
+    if (!tile_range(r, rect, &tx1, &ty1, &tx2, &ty2))
+	return;
+    for (int ty = ty1; ty < ty2; ty++)
+	memset(r->dirty + ty * r->tiles_x + tx1, 1, tx2 - tx1);
+}
+
+/**** zones ****/
+
+/* a mask reads all the pixels under it, so an area with masks has to be
+ * rendered by one job. such areas are gathered into zones, which are
+ * aligned to tiles and don't overlap each other.
+ */
+
+static void snap_to_tiles(struct render_t *r, cairo_rectangle_int_t *rect)
+{
+    int tx1, ty1, tx2, ty2;
+    tile_range(r, rect, &tx1, &ty1, &tx2, &ty2);
+    rect->x = tx1 * TILE_SIZE;
+    rect->y = ty1 * TILE_SIZE;
+    rect->width = MIN(tx2 * TILE_SIZE, r->width) - rect->x;
+    rect->height = MIN(ty2 * TILE_SIZE, r->height) - rect->y;
+}
+
+static GArray *make_zones(struct render_t *r, struct history_t *hp)
+{
+    GArray *zones = g_array_new(FALSE, FALSE, sizeof(cairo_rectangle_int_t));
+    cairo_rectangle_int_t bounds = { 0, 0, r->width, r->height };
+    
+    for (int i = 0; i < hp->nparts; i++) {
+	struct parts_t *p = hp->parts[i];
+	if (p->type != PARTS_MASK)
+	    continue;
+	cairo_rectangle_int_t rect;
+	call_get_bbox(p, &rect);
+	rect.x -= r->x;
+	rect.y -= r->y;
+	if (!bbox_intersects(&bounds, &rect))
+	    continue;
+	snap_to_tiles(r, &rect);
+	g_array_append_val(zones, rect);
+    }
+    
+    gboolean merged;
+    do {
+	merged = FALSE;
+	for (guint i = 0; i < zones->len && !merged; i++) {
+	    for (guint j = i + 1; j < zones->len; j++) {
+		cairo_rectangle_int_t *zi = &g_array_index(zones, cairo_rectangle_int_t, i);
+		cairo_rectangle_int_t *zj = &g_array_index(zones, cairo_rectangle_int_t, j);
+		if (bbox_intersects(zi, zj)) {
+		    bbox_union(zi, zj);
+		    g_array_remove_index_fast(zones, j);
+		    merged = TRUE;
+		    break;
+		}
+	    }
+	}
+    } while (merged);
+    
+    return zones;
+}
+
+/**** jobs ****/
+
+struct batch_t {
+    GMutex lock;
+    GCond cond;
+    int remaining;
+};
+
+struct job_t {
+    cairo_surface_t *target;
+    int x, y;			/* of the target on the canvas */
+    cairo_rectangle_int_t rect;	/* on the target */
+    render_paint_t paint;
+    void *data;
+    struct batch_t *batch;
+};
+
+/* renders rect of the target. the area is accessed through a surface of
+ * its own, so that jobs don't share cairo objects.
+ */
+static void render_rect(cairo_surface_t *target, int x, int y, const cairo_rectangle_int_t *rect,
+	render_paint_t paint, void *data)
+{
+    cairo_format_t format = cairo_image_surface_get_format(target);
+    int stride = cairo_image_surface_get_stride(target);
+    unsigned char *pixels = cairo_image_surface_get_data(target) + stride * rect->y + rect->x * 4;
+    
+    cairo_surface_t *sf = cairo_image_surface_create_for_data(pixels, format,
+	    rect->width, rect->height, stride);
+    cairo_surface_set_device_offset(sf, -(x + rect->x), -(y + rect->y));
+    cairo_t *cr = cairo_create(sf);
+    cairo_rectangle(cr, x + rect->x, y + rect->y, rect->width, rect->height);
+    cairo_clip(cr);
+    (*paint)(cr, data);
+    cairo_destroy(cr);
+    cairo_surface_flush(sf);
+    cairo_surface_destroy(sf);
+}
+
+static void worker(gpointer data, gpointer user_data)
+{
+    struct job_t *job = data;
+    struct batch_t *batch = job->batch;
+    
+    render_rect(job->target, job->x, job->y, &job->rect, job->paint, job->data);
+    
+    g_mutex_lock(&batch->lock);
+    if (--batch->remaining == 0)
+	g_cond_signal(&batch->cond);
+    g_mutex_unlock(&batch->lock);
+}
+
+/* renders may be run from several threads, as in batch mode. */
+static GThreadPool *get_pool(void)
+{
+    static gsize pool = 0;
+    
+    if (g_once_init_enter(&pool)) {
+	GError *err = NULL;
+	GThreadPool *p = g_thread_pool_new(worker, NULL, g_get_num_processors(), FALSE, &err);
+	if (p == NULL) {
+	    fprintf(stderr, "%s\n", err->message);
+	    exit(1);
+	}
+	g_once_init_leave(&pool, (gsize) p);
+    }
+    return (GThreadPool *) pool;
+}
+
+/* renders the jobs and waits for them. */
+static void run_jobs(GArray *jobs)
+{
+    if (jobs->len == 0)
+	return;
+    if (jobs->len == 1) {
+	struct job_t *job = &g_array_index(jobs, struct job_t, 0);
+	render_rect(job->target, job->x, job->y, &job->rect, job->paint, job->data);
+	return;
+    }
+    
+    struct batch_t batch;
+    g_mutex_init(&batch.lock);
+    g_cond_init(&batch.cond);
+    batch.remaining = jobs->len;
+    
+    GThreadPool *pool = get_pool();
+    for (guint i = 0; i < jobs->len; i++) {
+	struct job_t *job = &g_array_index(jobs, struct job_t, i);
+	job->batch = &batch;
+	g_thread_pool_push(pool, job, NULL);
+    }
+    
+    g_mutex_lock(&batch.lock);
+    while (batch.remaining > 0)
+	g_cond_wait(&batch.cond, &batch.lock);
+    g_mutex_unlock(&batch.lock);
+    
+    g_cond_clear(&batch.cond);
+    g_mutex_clear(&batch.lock);
+}
+
+/* renders the dirty tiles over rect (NULL for all), and the zones over them.
+ * the tiles are drawn on other threads, so the parts must have been
+ * prepared with call_prepare() on the main thread.
+ */
+void render_update(struct render_t *r, struct history_t *hp, const cairo_rectangle_int_t *rect,
+	render_paint_t paint, void *data)
+{
+    int tx1, ty1, tx2, ty2;
+    if (!tile_range(r, rect, &tx1, &ty1, &tx2, &ty2))
+	return;
+    
+    gboolean any = FALSE;
+    for (int ty = ty1; ty < ty2 && !any; ty++) {
+	for (int tx = tx1; tx < tx2 && !any; tx++)
+	    any = r->dirty[ty * r->tiles_x + tx];
+    }
+    if (!any)
+	return;
+    
+    GArray *zones = make_zones(r, hp);
+    int *zone_of = g_new(int, r->tiles_x * r->tiles_y);
+    for (int i = 0; i < r->tiles_x * r->tiles_y; i++)
+	zone_of[i] = -1;
+    for (guint z = 0; z < zones->len; z++) {
+	int zx1, zy1, zx2, zy2;
+	tile_range(r, &g_array_index(zones, cairo_rectangle_int_t, z), &zx1, &zy1, &zx2, &zy2);
+	
+	/* the pixels of a zone depend on each other, so a zone is dirty
+	 * as a whole once any of it is.
+	 */
+	gboolean dirty = FALSE;
+	for (int ty = zy1; ty < zy2; ty++) {
+	    for (int tx = zx1; tx < zx2; tx++) {
+		zone_of[ty * r->tiles_x + tx] = z;
+		dirty = dirty || r->dirty[ty * r->tiles_x + tx];
+	    }
+	}
+	if (dirty) {
+	    for (int ty = zy1; ty < zy2; ty++)
+		memset(r->dirty + ty * r->tiles_x + zx1, 1, zx2 - zx1);
+	}
+    }
+    
+    GArray *jobs = g_array_new(FALSE, FALSE, sizeof(struct job_t));
+    for (int ty = ty1; ty < ty2; ty++) {
+	for (int tx = tx1; tx < tx2; tx++) {
+	    int i = ty * r->tiles_x + tx;
+	    if (!r->dirty[i])
+		continue;
+	    
+	    struct job_t job = {
+		.target = r->surface,
+		.x = r->x,
+		.y = r->y,
+		.paint = paint,
+		.data = data,
+	    };
+	    if (zone_of[i] >= 0) {
+		job.rect = g_array_index(zones, cairo_rectangle_int_t, zone_of[i]);
+		int zx1, zy1, zx2, zy2;
+		tile_range(r, &job.rect, &zx1, &zy1, &zx2, &zy2);
+		for (int zy = zy1; zy < zy2; zy++)
+		    memset(r->dirty + zy * r->tiles_x + zx1, 0, zx2 - zx1);
+	    } else {
+		job.rect.x = tx * TILE_SIZE;
+		job.rect.y = ty * TILE_SIZE;
+		job.rect.width = MIN(TILE_SIZE, r->width - job.rect.x);
+		job.rect.height = MIN(TILE_SIZE, r->height - job.rect.y);
+		r->dirty[i] = 0;
+	    }
+	    g_array_append_val(jobs, job);
+	}
+    }
+    
+    cairo_surface_flush(r->surface);
+    run_jobs(jobs);
+    cairo_surface_mark_dirty(r->surface);
+    
+    g_array_free(jobs, TRUE);
+    g_free(zone_of);
+    g_array_free(zones, TRUE);
+}
+
+/* renders the area of the canvas at (x, y) of the size of an image surface. */
+void render_area(cairo_surface_t *target, int x, int y, struct history_t *hp, render_paint_t paint, void *data)
+{
+    struct render_t r;
+    
+    r.surface = target;
+    r.x = x;
+    r.y = y;
+    r.width = cairo_image_surface_get_width(target);
+    r.height = cairo_image_surface_get_height(target);
+    r.tiles_x = (r.width + TILE_SIZE - 1) / TILE_SIZE;
+    r.tiles_y = (r.height + TILE_SIZE - 1) / TILE_SIZE;
+    r.dirty = g_malloc(r.tiles_x * r.tiles_y);
+    memset(r.dirty, 1, r.tiles_x * r.tiles_y);
+    
+    render_update(&r, hp, NULL, paint, data);
+    
+    g_free(r.dirty);
+}
+
+void render_all(cairo_surface_t *target, struct history_t *hp, render_paint_t paint, void *data)
+{
+    render_area(target, 0, 0, hp, paint, data);
+}
+
+/**** png ****/
+
+#define PNG_BAND_BYTES	(4 << 20)
+
+/* a band ending at y would cut the masks across y, which need all of
+ * their area to be drawn at once. moves y down below them.
+ */
+static int band_end(struct history_t *hp, int y)
+{
+    gboolean moved;
+    
+    do {
+	moved = FALSE;
+	for (int i = 0; i < hp->nparts; i++) {
+	    struct parts_t *p = hp->parts[i];
+	    if (p->type != PARTS_MASK)
+		continue;
+	    cairo_rectangle_int_t rect;
+	    call_get_bbox(p, &rect);
+	    if (rect.y < y && y < rect.y + rect.height) {
+		y = rect.y + rect.height;
+		moved = TRUE;
+	    }
+	}
+    } while (moved);
+    
+    return y;
+}
+
+/* renders the image in horizontal bands, and encodes each band as soon as
+ * it is rendered, so that the whole image is never in memory.
+ * the progress is set to *progress in 1/1000 if it is not NULL.
+ * returns FALSE with errno set on failure.
+ */
+gboolean render_png(struct history_t *hp, render_paint_t paint, void *data, int level,
+	png_write_func_t write, void *closure, gint *progress)
+{
+    int width = hp->parts[0]->width;
+    int height = hp->parts[0]->height;
+    int band_height = MAX(PNG_BAND_BYTES / (width * 4), 16);
+    gboolean ok = TRUE;
+    int err = 0;
+    
+    struct png_writer_t *w = png_writer_new(width, height, level, write, closure);
+    for (int y = 0, y2; ok && y < height; y = y2) {
+	y2 = MIN(band_end(hp, MIN(y + band_height, height)), height);
+	
+	cairo_surface_t *band = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, y2 - y);
+	if (cairo_surface_status(band) != CAIRO_STATUS_SUCCESS) {
+	    cairo_surface_destroy(band);
+	    err = ENOMEM;
+	    ok = FALSE;
+	    break;
+	}
+	render_area(band, 0, y, hp, paint, data);
+	cairo_surface_flush(band);
+	ok = png_writer_add_rows(w, cairo_image_surface_get_data(band),
+		cairo_image_surface_get_stride(band), y2 - y);
+	cairo_surface_destroy(band);
+	
+	if (progress != NULL)
+	    g_atomic_int_set(progress, (gint64) y2 * 1000 / height);
+    }
+    
+    ok = png_writer_finish(w) && ok;
+    if (err != 0)
+	errno = err;
+    return ok;
+}
@@ -0,0 +1,40 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RENDER_H__INCLUDED
+#define RENDER_H__INCLUDED
+
+/* renders a scene into a RGB24 or ARGB32 image surface by tiles, in parallel.
+ * paint() is called on worker threads, with cr clipped to an area of the
+ * canvas. it may only read hp.
+ */
+typedef void (*render_paint_t)(cairo_t *cr, void *data);
+
+struct render_t;
+
+struct render_t *render_new(int width, int height);
+void render_free(struct render_t *r);
+cairo_surface_t *render_get_surface(struct render_t *r);
+void render_invalidate(struct render_t *r, const cairo_rectangle_int_t *rect);
+void render_update(struct render_t *r, struct history_t *hp, const cairo_rectangle_int_t *rect,
+	render_paint_t paint, void *data);
+void render_area(cairo_surface_t *target, int x, int y, struct history_t *hp,
+	render_paint_t paint, void *data);
+void render_all(cairo_surface_t *target, struct history_t *hp, render_paint_t paint, void *data);
+gboolean render_png(struct history_t *hp, render_paint_t paint, void *data, int level,
+	png_write_func_t write, void *closure, gint *progress);
+
+#endif	/* ifndef RENDER_H__INCLUDED */
@@ -44,8 +44,11 @@ static void (*thickness_changed_callback)(int thickness);
 static void color_changed_cb(GtkColorButton *widget, gpointer user_data)
 {
     if (!skip_color_callback) {
-	if (color_changed_callback != NULL)
-	    (*color_changed_callback)(settings_get_color());
+	if (color_changed_callback != NULL) {
+	    GdkRGBA rgba;
+	    settings_get_color(&rgba);
+	    (*color_changed_callback)(&rgba);
+	}
     }
 }
 
@@ -68,15 +71,9 @@ static void thickness_changed_cb(GtkSpinButton *widget, gpointer user_data)
     }
 }
 
-static const GdkRGBA *initial_color(void)
+static void initial_color(GdkRGBA *rgba)
 {
-    static gboolean inited = FALSE;
-    static GdkRGBA rgba;
-    if (!inited) {
-	gdk_rgba_parse(&rgba, INITIAL_COLOR);
-	inited = TRUE;
-    }
-    return &rgba;
+    gdk_rgba_parse(rgba, INITIAL_COLOR);
 }
 
 void settings_set_color_changed_callback(void (*func)(const GdkRGBA *))
@@ -94,14 +91,12 @@ void settings_set_thickness_changed_callback(void (*func)(int))
     thickness_changed_callback = func;
 }
 
-const GdkRGBA *settings_get_color(void)
+void settings_get_color(GdkRGBA *rgba)
 {
-    if (color != NULL) {
-	static GdkRGBA rgba;
-	gtk_color_chooser_get_rgba(GTK_COLOR_CHOOSER(color), &rgba);
-	return &rgba;
-    } else
-	return initial_color();
+    if (color != NULL)
+	gtk_color_chooser_get_rgba(GTK_COLOR_CHOOSER(color), rgba);
+    else
+	initial_color(rgba);
 }
 
 char *settings_get_font(void)
@@ -175,13 +170,13 @@ void settings_set_default_thickness(int value)
 
 GtkWidget *settings_create_widgets(void)
 {
-    default_color = *initial_color();
+    initial_color(&default_color);
     default_fontname = g_strdup(INITIAL_FONT);
     default_thickness = INITIAL_THICKNESS;
     
     GtkWidget *hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
     
-    color = gtk_color_button_new_with_rgba(initial_color());
+    color = gtk_color_button_new_with_rgba(&default_color);
     gtk_widget_set_tooltip_text(color, _("Color"));
     g_signal_connect(G_OBJECT(color), "color-set", G_CALLBACK(color_changed_cb), NULL);
     gtk_box_pack_start(GTK_BOX(hbox), color, FALSE, FALSE, 0);
@@ -21,7 +21,7 @@ GtkWidget *settings_create_widgets(void);
 void settings_set_color_changed_callback(void (*func)(const GdkRGBA *));
 void settings_set_font_changed_callback(void (*func)(const char *));
 void settings_set_thickness_changed_callback(void (*func)(int));
-const GdkRGBA *settings_get_color(void);
+void settings_get_color(GdkRGBA *rgba);
 char *settings_get_font(void);
 int settings_get_thickness(void);
 void settings_set_color(const GdkRGBA *rgba);
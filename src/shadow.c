@@ -0,0 +1,300 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <gtk/gtk.h>
+
+#include "bbox.h"
+#include "filter.h"
+#include "shadow.h"
+
+/* soft drop shadows.
+ * the shape is rasterized once into an A8 image, which is blurred and
+ * then used as a mask to paint the shadow color at the offset.
+ */
+
+const struct shadow_t shadow_default = {
+    .radius = 4,
+    .quality = 3,
+    .offset_x = 2,
+    .offset_y = 2,
+    .color = { 0, 0, 0, 0.5 },
+};
+
+static int blur_reach(const struct shadow_t *sh)
+{
+    return filter_blur_reach(sh->radius, sh->quality);
+}
+
+/* how far the shadow sticks out of the shape. */
+int shadow_extent(const struct shadow_t *sh)
+{
+    return blur_reach(sh) + MAX(ABS(sh->offset_x), ABS(sh->offset_y)) + 1;
+}
+
+/* makes the blurred alpha of what paint() draws in the extent.
+ * the result is larger than the extent by the reach of blur on each side.
+ */
+static cairo_surface_t *make_blurred(const struct shadow_t *sh, const cairo_rectangle_int_t *extent,
+	void (*paint)(cairo_t *cr, void *data), void *data)
+{
+    int reach = blur_reach(sh);
+    int width = extent->width + reach * 2;
+    int height = extent->height + reach * 2;
+    
+    cairo_surface_t *sf = cairo_image_surface_create(CAIRO_FORMAT_A8, width, height);
+    cairo_t *cr = cairo_create(sf);
+    cairo_translate(cr, reach - extent->x, reach - extent->y);
+    cairo_set_source_rgba(cr, 0, 0, 0, 1);
+    (*paint)(cr, data);
+    cairo_destroy(cr);
+    cairo_surface_flush(sf);
+    
+    filter_blur_alpha(cairo_image_surface_get_data(sf), cairo_image_surface_get_stride(sf),
+	    width, height, sh->radius, sh->quality);
+    cairo_surface_mark_dirty(sf);
+    
+    return sf;
+}
+
+void shadow_draw_sprite(cairo_t *cr, const struct shadow_t *sh, cairo_surface_t *sprite, double x, double y)
+{
+    cairo_save(cr);
+    cairo_set_source_rgba(cr, sh->color.red, sh->color.green, sh->color.blue, sh->color.alpha);
+    cairo_mask_surface(cr, sprite, x + sh->offset_x, y + sh->offset_y);
+    cairo_restore(cr);
+}
+
+/* draws the shadow of what paint() draws in the extent. */
+void shadow_draw(cairo_t *cr, const struct shadow_t *sh, const cairo_rectangle_int_t *extent,
+	void (*paint)(cairo_t *cr, void *data), void *data)
+{
+    int reach = blur_reach(sh);
+    
+    /* no need to blur what is out of the clip. */
+    double x1, y1, x2, y2;
+    cairo_clip_extents(cr, &x1, &y1, &x2, &y2);
+    cairo_rectangle_int_t clip;
+    bbox_from_corners(&clip, floor(x1), floor(y1), ceil(x2), ceil(y2));
+    bbox_inflate(&clip, shadow_extent(sh));
+    clip.x -= sh->offset_x;
+    clip.y -= sh->offset_y;
+    if (!bbox_intersects(&clip, extent))
+	return;
+    cairo_rectangle_int_t area = *extent;
+    if (!bbox_contains(&clip, &area)) {
+	int ax2 = MIN(area.x + area.width, clip.x + clip.width);
+	int ay2 = MIN(area.y + area.height, clip.y + clip.height);
+	area.x = MAX(area.x, clip.x);
+	area.y = MAX(area.y, clip.y);
+	area.width = ax2 - area.x;
+	area.height = ay2 - area.y;
+    }
+    
+    cairo_surface_t *sf = make_blurred(sh, &area, paint, data);
+    shadow_draw_sprite(cr, sh, sf, area.x - reach, area.y - reach);
+    cairo_surface_destroy(sf);
+}
+
+static void paint_image(cairo_t *cr, void *data)
+{
+    cairo_set_source_surface(cr, data, 0, 0);
+    cairo_paint(cr);
+}
+
+/* makes the shadow of the alpha of an image, to be cached by the caller.
+ * draw it at the position of the image + (*x, *y) with shadow_draw_sprite().
+ */
+cairo_surface_t *shadow_make_sprite(const struct shadow_t *sh, cairo_surface_t *image, int *x, int *y)
+{
+    cairo_rectangle_int_t extent = {
+	0, 0, cairo_image_surface_get_width(image), cairo_image_surface_get_height(image),
+    };
+    *x = *y = -blur_reach(sh);
+    return make_blurred(sh, &extent, paint_image, image);
+}
+
+static void paint_rect(cairo_t *cr, void *data)
+{
+    cairo_rectangle_int_t *r = data;
+    cairo_rectangle(cr, r->x, r->y, r->width, r->height);
+    cairo_fill(cr);
+}
+
+/* the shadow of a filled rect. */
+void shadow_draw_rect(cairo_t *cr, const struct shadow_t *sh, int x, int y, int width, int height)
+{
+    cairo_rectangle_int_t r;
+    bbox_from_corners(&r, x, y, x + width, y + height);
+    shadow_draw(cr, sh, &r, paint_rect, &r);
+}
+
+/**** shadows of rect frames ****/
+
+/* a shadow of a long straight stroke is the same everywhere along it,
+ * so the shadow of a rect frame is made of a nine-patch: the shadow of
+ * a small frame is drawn at the corners as is, and the middle of its
+ * sides is stretched along the sides.
+ * inside of the frame stays transparent.
+ */
+
+struct frame_t {
+    double thickness;
+    int corner;		/* half size of a corner patch */
+    int size;		/* of the small frame */
+};
+
+static void paint_frame(cairo_t *cr, void *data)
+{
+    struct frame_t *f = data;
+    cairo_set_line_width(cr, f->thickness);
+    cairo_rectangle(cr, f->corner, f->corner, f->size, f->size);
+    cairo_stroke(cr);
+}
+
+#define PATCH_CACHE_NR 4
+
+static struct {
+    double thickness;
+    int radius, quality;
+    cairo_surface_t *surface;
+} patch_cache[PATCH_CACHE_NR];
+static int patch_cache_next;
+G_LOCK_DEFINE_STATIC(patch_cache);
+
+/* returns a new reference to the shadow of the small frame. */
+static cairo_surface_t *get_patch(const struct shadow_t *sh, struct frame_t *f)
+{
+    cairo_surface_t *sf = NULL;
+    
+    G_LOCK(patch_cache);
+    for (int i = 0; i < PATCH_CACHE_NR; i++) {
+	if (patch_cache[i].surface != NULL
+		&& patch_cache[i].thickness == f->thickness
+		&& patch_cache[i].radius == sh->radius
+		&& patch_cache[i].quality == sh->quality) {
+	    sf = cairo_surface_reference(patch_cache[i].surface);
+	    break;
+	}
+    }
+    G_UNLOCK(patch_cache);
+    if (sf != NULL)
+	return sf;
+    
+    int reach = blur_reach(sh);
+    cairo_rectangle_int_t extent = {
+	reach, reach, f->size + f->corner * 2 - reach * 2, f->size + f->corner * 2 - reach * 2,
+    };
+    sf = make_blurred(sh, &extent, paint_frame, f);
+    
+    G_LOCK(patch_cache);
+    int i = patch_cache_next++ % PATCH_CACHE_NR;
+    if (patch_cache[i].surface != NULL)
+	cairo_surface_destroy(patch_cache[i].surface);
+    patch_cache[i].thickness = f->thickness;
+    patch_cache[i].radius = sh->radius;
+    patch_cache[i].quality = sh->quality;
+    patch_cache[i].surface = cairo_surface_reference(sf);
+    G_UNLOCK(patch_cache);
+    
+    return sf;
+}
+
+/* masks with the part (px, py, pw, ph) of the patch put at (x, y).
+ * the part is stretched to (width, height) by repeating its edge pixels.
+ */
+static void draw_patch(cairo_t *cr, const struct shadow_t *sh, cairo_surface_t *patch,
+	int px, int py, int pw, int ph, int x, int y, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+	return;
+    
+    cairo_surface_t *sub = cairo_surface_create_for_rectangle(patch, px, py, pw, ph);
+    cairo_pattern_t *pat = cairo_pattern_create_for_surface(sub);
+    cairo_pattern_set_extend(pat, CAIRO_EXTEND_PAD);
+    cairo_pattern_set_filter(pat, CAIRO_FILTER_NEAREST);
+    cairo_matrix_t mat;
+    cairo_matrix_init_translate(&mat, -(x + sh->offset_x), -(y + sh->offset_y));
+    cairo_pattern_set_matrix(pat, &mat);
+    
+    cairo_save(cr);
+    cairo_rectangle(cr, x + sh->offset_x, y + sh->offset_y, width, height);
+    cairo_clip(cr);
+    cairo_set_source_rgba(cr, sh->color.red, sh->color.green, sh->color.blue, sh->color.alpha);
+    cairo_mask(cr, pat);
+    cairo_restore(cr);
+    
+    cairo_pattern_destroy(pat);
+    cairo_surface_destroy(sub);
+}
+
+static void paint_stroked_rect(cairo_t *cr, void *data)
+{
+    double *r = data;
+    cairo_set_line_width(cr, r[4]);
+    cairo_rectangle(cr, r[0], r[1], r[2], r[3]);
+    cairo_stroke(cr);
+}
+
+/* the shadow of a rect stroked with the thickness. */
+void shadow_draw_rect_frame(cairo_t *cr, const struct shadow_t *sh,
+	int x, int y, int width, int height, double thickness)
+{
+    if (width < 0) {
+	x += width;
+	width = -width;
+    }
+    if (height < 0) {
+	y += height;
+	height = -height;
+    }
+    
+    struct frame_t f;
+    f.thickness = thickness;
+    f.corner = ceil(thickness / 2) + blur_reach(sh) + 1;
+    f.size = f.corner * 2 + 2;
+    
+    if (width < f.size || height < f.size) {
+	/* too small to stretch. */
+	double r[5] = { x, y, width, height, thickness };
+	cairo_rectangle_int_t extent;
+	bbox_from_corners(&extent, x, y, x + width, y + height);
+	bbox_inflate(&extent, ceil(thickness / 2) + 1);
+	shadow_draw(cr, sh, &extent, paint_stroked_rect, r);
+	return;
+    }
+    
+    cairo_surface_t *patch = get_patch(sh, &f);
+    int c = f.corner;
+    int s = f.size;
+    int mid = c + s / 2;
+    
+    /* corners */
+    draw_patch(cr, sh, patch, 0,     0,     c * 2, c * 2, x - c,         y - c,          c * 2, c * 2);
+    draw_patch(cr, sh, patch, s,     0,     c * 2, c * 2, x + width - c, y - c,          c * 2, c * 2);
+    draw_patch(cr, sh, patch, 0,     s,     c * 2, c * 2, x - c,         y + height - c, c * 2, c * 2);
+    draw_patch(cr, sh, patch, s,     s,     c * 2, c * 2, x + width - c, y + height - c, c * 2, c * 2);
+    
+    /* sides */
+    draw_patch(cr, sh, patch, mid,   0,     1,     c * 2, x + c,         y - c,          width - c * 2, c * 2);
+    draw_patch(cr, sh, patch, mid,   s,     1,     c * 2, x + c,         y + height - c, width - c * 2, c * 2);
+    draw_patch(cr, sh, patch, 0,     mid,   c * 2, 1,     x - c,         y + c,          c * 2, height - c * 2);
+    draw_patch(cr, sh, patch, s,     mid,   c * 2, 1,     x + width - c, y + c,          c * 2, height - c * 2);
+    
+    cairo_surface_destroy(patch);
+}
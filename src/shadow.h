@@ -0,0 +1,38 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SHADOW_H__INCLUDED
+#define SHADOW_H__INCLUDED
+
+struct shadow_t {
+    int radius;			/* of blur, in pixels */
+    int quality;		/* passes of box blur. 3 is close to gaussian. */
+    int offset_x, offset_y;
+    GdkRGBA color;
+};
+
+extern const struct shadow_t shadow_default;
+
+int shadow_extent(const struct shadow_t *sh);
+void shadow_draw(cairo_t *cr, const struct shadow_t *sh, const cairo_rectangle_int_t *extent,
+	void (*paint)(cairo_t *cr, void *data), void *data);
+void shadow_draw_rect(cairo_t *cr, const struct shadow_t *sh, int x, int y, int width, int height);
+void shadow_draw_rect_frame(cairo_t *cr, const struct shadow_t *sh,
+	int x, int y, int width, int height, double thickness);
+cairo_surface_t *shadow_make_sprite(const struct shadow_t *sh, cairo_surface_t *image, int *x, int *y);
+void shadow_draw_sprite(cairo_t *cr, const struct shadow_t *sh, cairo_surface_t *sprite, double x, double y);
+
+#endif	/* ifndef SHADOW_H__INCLUDED */
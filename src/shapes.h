@@ -17,39 +17,52 @@
 #ifndef SHAPES_H__INCLUDED
 #define SHAPES_H__INCLUDED
 
-void rect_draw(struct parts_t *parts, cairo_t *cr, gboolean selected);
+void rect_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected);
 void rect_draw_handle(struct parts_t *parts, cairo_t *cr);
-gboolean rect_select(struct parts_t *parts, int x, int y, gboolean selected);
-void rect_drag_step(struct parts_t *parts, int x, int y);
-void rect_drag_fini(struct parts_t *parts, int x, int y);
-struct parts_t *rect_create(int x, int y);
+gboolean rect_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected);
+void rect_drag_step(struct parts_t *parts, struct drag_t *drag, int x, int y);
+void rect_drag_fini(struct parts_t *parts, struct drag_t *drag, int x, int y);
+void rect_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect);
+struct parts_t *rect_create(struct render_ctx_t *ctx, int x, int y);
 
-void arrow_draw(struct parts_t *parts, cairo_t *cr, gboolean selected);
+void arrow_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected);
 void arrow_draw_handle(struct parts_t *parts, cairo_t *cr);
-gboolean arrow_select(struct parts_t *parts, int x, int y, gboolean selected);
-void arrow_drag_step(struct parts_t *p, int x, int y);
-void arrow_drag_fini(struct parts_t *parts, int x, int y);
-struct parts_t *arrow_create(int x, int y);
+gboolean arrow_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected);
+void arrow_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y);
+void arrow_drag_fini(struct parts_t *parts, struct drag_t *drag, int x, int y);
+void arrow_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect);
+struct parts_t *arrow_create(struct render_ctx_t *ctx, int x, int y);
 
-void text_draw(struct parts_t *parts, cairo_t *cr, gboolean selected);
+void text_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected);
 void text_draw_handle(struct parts_t *parts, cairo_t *cr);
-gboolean text_select(struct parts_t *parts, int x, int y, gboolean selected);
-void text_drag_step(struct parts_t *p, int x, int y);
-void text_drag_fini(struct parts_t *parts, int x, int y);
-struct parts_t *text_create(int x, int y);
+gboolean text_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected);
+void text_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y);
+void text_drag_fini(struct parts_t *parts, struct drag_t *drag, int x, int y);
+void text_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect);
+void text_prepare(struct render_ctx_t *ctx, struct parts_t *parts);
+struct parts_t *text_create(struct render_ctx_t *ctx, int x, int y);
+int text_index_at(struct render_ctx_t *ctx, struct parts_t *parts, int x, int y);
+int text_next_pos_in_bytes(const char *text, int pos);
+int text_prev_pos_in_bytes(const char *text, int pos);
+void text_cache_ref(struct text_cache_t *cache);
+void text_cache_unref(struct text_cache_t *cache);
+size_t text_cache_size(struct text_cache_t *cache);
+
+/* in the window */
 gboolean text_filter_keypress(GdkEventKey *ev);
 void text_focus_in(void);
 void text_focus_out(void);
-void text_init(GtkWidget *top, GtkWidget *w);
+void text_init(GtkWidget *top, struct render_ctx_t *ctx);
 void text_focus(struct parts_t *parts, int x, int y);
 void text_unfocus(void);
 gboolean text_has_focus(void);
 
-void mask_draw(struct parts_t *parts, cairo_t *cr, gboolean selected);
+void mask_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected);
 void mask_draw_handle(struct parts_t *parts, cairo_t *cr);
-gboolean mask_select(struct parts_t *parts, int x, int y, gboolean selected);
-void mask_drag_step(struct parts_t *p, int x, int y);
-void mask_drag_fini(struct parts_t *parts, int x, int y);
-struct parts_t *mask_create(int x, int y);
+gboolean mask_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected);
+void mask_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y);
+void mask_drag_fini(struct parts_t *parts, struct drag_t *drag, int x, int y);
+void mask_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect);
+struct parts_t *mask_create(struct render_ctx_t *ctx, int x, int y);
 
 #endif	/* ifndef SHAPES_H__INCLUDED */
@@ -19,12 +19,14 @@
 #include <gtk/gtk.h>
 
 #include "common.h"
+#include "main.h"
 #include "shapes.h"
 #include "state_mgmt.h"
 
 struct mode_edit_work_t {
     int step;
     int beg_x, beg_y;
+    struct drag_t drag;
     guint32 last_click_time;
     struct parts_t *last_click_parts;
 };
@@ -32,7 +34,7 @@ struct mode_edit_work_t {
 static void mode_edit_init(struct mode_edit_work_t *w)
 {
     memset(w, 0, sizeof *w);
-    undoable->selp = NULL;
+    doc->hp->selp = NULL;
 }
 
 static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
@@ -49,12 +51,13 @@ static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
     case STEP_IDLE:
 	if (ev->type == GDK_BUTTON_PRESS && ev->button.button == 1) {
 	    GdkEventButton *ep = &ev->button;
-	    for (struct parts_t *p = undoable->parts_list_end; p != NULL; p = p->back) {
-		if (call_select(p, ep->x, ep->y, p == undoable->selp)) {
+	    for (int i = doc->hp->nparts - 1; i >= 0; i--) {
+		struct parts_t *p = doc->hp->parts[i];
+		if (call_select(p, &w->drag, ep->x, ep->y, p == doc->hp->selp)) {
 		    if (p->type == PARTS_BASE)
-			undoable->selp = NULL;
+			doc->hp->selp = NULL;
 		    else {
-			undoable->selp = p;
+			doc->hp->selp = p;
 			w->step = STEP_AFTER_PRESS;
 		    }
 		    break;
@@ -66,14 +69,14 @@ static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
     case STEP_AFTER_PRESS:
 	if (ev->type == GDK_BUTTON_RELEASE && ev->button.button == 1) {
 	    GdkEventButton *ep = &ev->button;
-	    if (ep->time - w->last_click_time < 500 && w->last_click_parts == undoable->selp && undoable->selp->type == PARTS_TEXT) {
+	    if (ep->time - w->last_click_time < 500 && w->last_click_parts == doc->hp->selp && doc->hp->selp->type == PARTS_TEXT) {
 		/* double click */
-		history_copy_top_of_undoable();
-		text_focus(undoable->selp, ep->x, ep->y);
+		history_change_parts(doc, doc->hp->selp, CHANGE_ANY);
+		text_focus(doc->hp->selp, ep->x, ep->y);
 		w->step = STEP_EDITING_TEXT;
 	    } else {
 		/* maybe single */
-		w->last_click_parts = undoable->selp;
+		w->last_click_parts = doc->hp->selp;
 		w->last_click_time = ep->time;
 		w->step = STEP_IDLE;
 	    }
@@ -89,9 +92,9 @@ static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
 		dy = -dy;
 #define EPSILON 3
 	    if (dx >= EPSILON || dy >= EPSILON) {
-		history_copy_top_of_undoable();
-		struct parts_t *p = undoable->selp;
-		call_drag_step(p, ep->x, ep->y);
+		struct parts_t *p = history_change_parts(doc, doc->hp->selp, CHANGE_ANY);
+		layer_cache_build(history_index_of(doc->hp, p));
+		call_drag_step(p, &w->drag, ep->x, ep->y);
 		w->last_click_parts = NULL;
 		w->last_click_time = 0;
 		w->step = STEP_MOTION;
@@ -104,16 +107,17 @@ static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
     case STEP_MOTION:
 	if (ev->type == GDK_BUTTON_RELEASE && ev->button.button == 1) {
 	    GdkEventButton *ep = &ev->button;
-	    struct parts_t *p = undoable->selp;
-	    call_drag_step(p, ep->x, ep->y);
-	    call_drag_fini(p, ep->x, ep->y);
+	    struct parts_t *p = history_writable_parts(doc->hp, doc->hp->selp);
+	    call_drag_step(p, &w->drag, ep->x, ep->y);
+	    call_drag_fini(p, &w->drag, ep->x, ep->y);
+	    layer_cache_drop();
 	    w->step = STEP_IDLE;
 	    break;
 	}
 	if (ev->type == GDK_MOTION_NOTIFY) {
 	    GdkEventMotion *ep = &ev->motion;
-	    struct parts_t *p = undoable->selp;
-	    call_drag_step(p, ep->x, ep->y);
+	    struct parts_t *p = history_writable_parts(doc->hp, doc->hp->selp);
+	    call_drag_step(p, &w->drag, ep->x, ep->y);
 	    break;
 	}
 	break;
@@ -121,16 +125,17 @@ static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
     case STEP_EDITING_TEXT:
 	if (ev->type == GDK_BUTTON_PRESS && ev->button.button == 1) {
 	    GdkEventButton *ep = &ev->button;
-	    for (struct parts_t *p = undoable->parts_list_end; p != NULL; p = p->back) {
-		if (call_select(p, ep->x, ep->y, p == undoable->selp)) {
+	    for (int i = doc->hp->nparts - 1; i >= 0; i--) {
+		struct parts_t *p = doc->hp->parts[i];
+		if (call_select(p, &w->drag, ep->x, ep->y, p == doc->hp->selp)) {
 		    if (p->type == PARTS_BASE) {
-			undoable->selp = NULL;
+			doc->hp->selp = NULL;
 			text_unfocus();
 			w->step = STEP_IDLE;
-		    } else if (p == undoable->selp) {
+		    } else if (p == doc->hp->selp) {
 			w->step = STEP_AFTER_PRESS_TEXT;
 		    } else {
-			undoable->selp = p;
+			doc->hp->selp = p;
 			text_unfocus();
 			w->step = STEP_AFTER_PRESS;
 		    }
@@ -143,7 +148,7 @@ static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
     case STEP_AFTER_PRESS_TEXT:
 	if (ev->type == GDK_BUTTON_RELEASE && ev->button.button == 1) {
 	    GdkEventButton *ep = &ev->button;
-	    text_focus(undoable->selp, ep->x, ep->y);
+	    text_focus(doc->hp->selp, ep->x, ep->y);
 	    w->step = STEP_EDITING_TEXT;
 	    break;
 	}
@@ -157,9 +162,9 @@ static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
 		dy = -dy;
 #define EPSILON 3
 	    if (dx >= EPSILON || dy >= EPSILON) {
-		history_copy_top_of_undoable();
-		struct parts_t *p = undoable->selp;
-		call_drag_step(p, ep->x, ep->y);
+		struct parts_t *p = history_change_parts(doc, doc->hp->selp, CHANGE_ANY);
+		layer_cache_build(history_index_of(doc->hp, p));
+		call_drag_step(p, &w->drag, ep->x, ep->y);
 		w->last_click_parts = NULL;
 		w->last_click_time = 0;
 		text_unfocus();
@@ -174,7 +179,13 @@ static void mode_edit_handle(struct mode_edit_work_t *w, GdkEvent *ev)
 
 static void mode_edit_fini(struct mode_edit_work_t *w)
 {
-    undoable->selp = NULL;
+    doc->hp->selp = NULL;
+}
+
+/* the part being created, which is the last one. */
+static struct parts_t *created_parts(void)
+{
+    return history_writable_parts(doc->hp, doc->hp->parts[doc->hp->nparts - 1]);
 }
 
 struct mode_rect_work_t {
@@ -184,7 +195,7 @@ struct mode_rect_work_t {
 static void mode_rect_init(struct mode_rect_work_t *w)
 {
     memset(w, 0, sizeof *w);
-    undoable->selp = NULL;
+    doc->hp->selp = NULL;
 }
 
 static void mode_rect_handle(struct mode_rect_work_t *w, GdkEvent *ev)
@@ -192,11 +203,9 @@ static void mode_rect_handle(struct mode_rect_work_t *w, GdkEvent *ev)
     switch (w->step) {
     case 0:
 	if (ev->type == GDK_BUTTON_PRESS && ev->button.button == 1) {
-	    history_copy_top_of_undoable();
-	    struct history_t *hp = undoable;
-	    
-	    struct parts_t *p = rect_create(ev->button.x, ev->button.y);
-	    history_append_parts(hp, p);
+	    struct parts_t *p = rect_create(doc->hp->ctx, ev->button.x, ev->button.y);
+	    history_add_parts(doc, p);
+	    layer_cache_build(doc->hp->nparts - 1);
 	    
 	    w->step++;
 	}
@@ -204,13 +213,16 @@ static void mode_rect_handle(struct mode_rect_work_t *w, GdkEvent *ev)
 	
     case 1:
 	if (ev->type == GDK_MOTION_NOTIFY) {
-	    undoable->parts_list_end->width = ev->motion.x - undoable->parts_list_end->x;
-	    undoable->parts_list_end->height = ev->motion.y - undoable->parts_list_end->y;
+	    struct parts_t *p = created_parts();
+	    p->width = ev->motion.x - p->x;
+	    p->height = ev->motion.y - p->y;
 	    break;
 	}
 	if (ev->type == GDK_BUTTON_RELEASE && ev->button.button == 1) {
-	    undoable->parts_list_end->width = ev->button.x - undoable->parts_list_end->x;
-	    undoable->parts_list_end->height = ev->button.y - undoable->parts_list_end->y;
+	    struct parts_t *p = created_parts();
+	    p->width = ev->button.x - p->x;
+	    p->height = ev->button.y - p->y;
+	    layer_cache_drop();
 	    w->step = 0;
 	    break;
 	}
@@ -229,7 +241,7 @@ struct mode_arrow_work_t {
 static void mode_arrow_init(struct mode_arrow_work_t *w)
 {
     memset(w, 0, sizeof *w);
-    undoable->selp = NULL;
+    doc->hp->selp = NULL;
 }
 
 static void mode_arrow_handle(struct mode_arrow_work_t *w, GdkEvent *ev)
@@ -237,11 +249,9 @@ static void mode_arrow_handle(struct mode_arrow_work_t *w, GdkEvent *ev)
     switch (w->step) {
     case 0:
 	if (ev->type == GDK_BUTTON_PRESS && ev->button.button == 1) {
-	    history_copy_top_of_undoable();
-	    struct history_t *hp = undoable;
-	    
-	    struct parts_t *p = arrow_create(ev->button.x, ev->button.y);
-	    history_append_parts(hp, p);
+	    struct parts_t *p = arrow_create(doc->hp->ctx, ev->button.x, ev->button.y);
+	    history_add_parts(doc, p);
+	    layer_cache_build(doc->hp->nparts - 1);
 	    
 	    w->step++;
 	}
@@ -249,13 +259,16 @@ static void mode_arrow_handle(struct mode_arrow_work_t *w, GdkEvent *ev)
 	
     case 1:
 	if (ev->type == GDK_MOTION_NOTIFY) {
-	    undoable->parts_list_end->width = ev->motion.x - undoable->parts_list_end->x;
-	    undoable->parts_list_end->height = ev->motion.y - undoable->parts_list_end->y;
+	    struct parts_t *p = created_parts();
+	    p->width = ev->motion.x - p->x;
+	    p->height = ev->motion.y - p->y;
 	    break;
 	}
 	if (ev->type == GDK_BUTTON_RELEASE && ev->button.button == 1) {
-	    undoable->parts_list_end->width = ev->button.x - undoable->parts_list_end->x;
-	    undoable->parts_list_end->height = ev->button.y - undoable->parts_list_end->y;
+	    struct parts_t *p = created_parts();
+	    p->width = ev->button.x - p->x;
+	    p->height = ev->button.y - p->y;
+	    layer_cache_drop();
 	    w->step = 0;
 	    break;
 	}
@@ -274,7 +287,7 @@ struct mode_text_work_t {
 static void mode_text_init(struct mode_text_work_t *w)
 {
     memset(w, 0, sizeof *w);
-    undoable->selp = NULL;
+    doc->hp->selp = NULL;
 }
 
 static void mode_text_handle(struct mode_text_work_t *w, GdkEvent *ev)
@@ -282,11 +295,8 @@ static void mode_text_handle(struct mode_text_work_t *w, GdkEvent *ev)
     switch (w->step) {
     case 0:
 	if (ev->type == GDK_BUTTON_PRESS && ev->button.button == 1) {
-	    history_copy_top_of_undoable();
-	    struct history_t *hp = undoable;
-	    
-	    struct parts_t *p = text_create(ev->button.x, ev->button.y);
-	    history_append_parts(hp, p);
+	    struct parts_t *p = text_create(doc->hp->ctx, ev->button.x, ev->button.y);
+	    history_add_parts(doc, p);
 	    text_focus(p, ev->button.x, ev->button.y);
 	    
 	    w->step++;
@@ -314,7 +324,7 @@ struct mode_mask_work_t {
 static void mode_mask_init(struct mode_mask_work_t *w)
 {
     memset(w, 0, sizeof *w);
-    undoable->selp = NULL;
+    doc->hp->selp = NULL;
 }
 
 static void mode_mask_handle(struct mode_mask_work_t *w, GdkEvent *ev)
@@ -322,11 +332,9 @@ static void mode_mask_handle(struct mode_mask_work_t *w, GdkEvent *ev)
     switch (w->step) {
     case 0:
 	if (ev->type == GDK_BUTTON_PRESS && ev->button.button == 1) {
-	    history_copy_top_of_undoable();
-	    struct history_t *hp = undoable;
-	    
-	    struct parts_t *p = mask_create(ev->button.x, ev->button.y);
-	    history_append_parts(hp, p);
+	    struct parts_t *p = mask_create(doc->hp->ctx, ev->button.x, ev->button.y);
+	    history_add_parts(doc, p);
+	    layer_cache_build(doc->hp->nparts - 1);
 	    
 	    w->step++;
 	}
@@ -334,13 +342,16 @@ static void mode_mask_handle(struct mode_mask_work_t *w, GdkEvent *ev)
 	
     case 1:
 	if (ev->type == GDK_MOTION_NOTIFY) {
-	    undoable->parts_list_end->width = ev->motion.x - undoable->parts_list_end->x;
-	    undoable->parts_list_end->height = ev->motion.y - undoable->parts_list_end->y;
+	    struct parts_t *p = created_parts();
+	    p->width = ev->motion.x - p->x;
+	    p->height = ev->motion.y - p->y;
 	    break;
 	}
 	if (ev->type == GDK_BUTTON_RELEASE && ev->button.button == 1) {
-	    undoable->parts_list_end->width = ev->button.x - undoable->parts_list_end->x;
-	    undoable->parts_list_end->height = ev->button.y - undoable->parts_list_end->y;
+	    struct parts_t *p = created_parts();
+	    p->width = ev->button.x - p->x;
+	    p->height = ev->button.y - p->y;
+	    layer_cache_drop();
 	    w->step = 0;
 	    break;
 	}
@@ -385,21 +396,59 @@ void mode_init(GtkWidget *widget)
     drawable = widget;
     mode = MODE_EDIT;
     (*modes[mode].init)(&work);
-    gtk_widget_queue_draw(drawable);
+    damage_all();
+}
+
+/* the part an event may change: the selected one in edit mode,
+ * and the one being created in the other modes.
+ */
+static struct parts_t *edited_parts(void)
+{
+    if (mode == MODE_EDIT)
+	return doc->hp->selp;
+    return doc->hp->parts[doc->hp->nparts - 1];
 }
 
 void mode_handle(GdkEvent *ev)
 {
+    cairo_rectangle_int_t r0, r1;
+    
+    struct parts_t *p0 = edited_parts();
+    if (p0 != NULL) {
+	call_prepare(doc->hp->ctx, p0);
+	call_get_bbox(p0, &r0);
+    }
+    
     (*modes[mode].handle)(&work, ev);
-    gtk_widget_queue_draw(drawable);
+    
+    struct parts_t *p1 = edited_parts();
+    if (p1 != NULL) {
+	call_prepare(doc->hp->ctx, p1);
+	call_get_bbox(p1, &r1);
+    }
+    
+    if (p0 != p1 || (p0 != NULL && memcmp(&r0, &r1, sizeof r0) != 0)) {
+	damage_add_parts(p0);
+	damage_add_parts(p1);
+    }
+    damage_flush();
+}
+
+/* ends editing the text, which was one step, and starts the mode over. */
+void mode_end_edit(void)
+{
+    text_unfocus();
+    (*modes[mode].fini)(&work);
+    (*modes[mode].init)(&work);
 }
 
 void mode_switch(int new_mode)
 {
     if (new_mode != mode) {
+	layer_cache_drop();
 	(*modes[mode].fini)(&work);
 	mode = new_mode;
 	(*modes[mode].init)(&work);
-	gtk_widget_queue_draw(drawable);
+	damage_all();
     }
 }
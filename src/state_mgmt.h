@@ -28,5 +28,6 @@ enum {
 void mode_init(GtkWidget *widget);
 void mode_handle(GdkEvent *ev);
 void mode_switch(int new_mode);
+void mode_end_edit(void);
 
 #endif	/* ifndef STATE_MGMT_H__INCLUDED */
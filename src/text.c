@@ -22,8 +22,21 @@
 #include "common.h"
 #include "shapes.h"
 #include "handle.h"
-#include "settings.h"
-#include "tcos.h"
+#include "bbox.h"
+#include "filter.h"
+#include "shadow.h"
+
+#define DIFF 4.0
+#define PADDING 32
+
+/* the cursor glows white on the dark shadow. */
+static const struct shadow_t cursor_shadow = {
+    .radius = 4,
+    .quality = 3,
+    .offset_x = 2,
+    .offset_y = 2,
+    .color = { 1, 1, 1, 0.5 },
+};
 
 enum {
     HANDLE_TOP_LEFT,
@@ -38,26 +51,6 @@ enum {
     HANDLE_NR
 };
 
-static int beg_x = 0, beg_y = 0;
-static int orig_x = 0, orig_y = 0, orig_w = 0, orig_h = 0;
-static int dragging_handle = -1;
-
-static int cursor_pos = 0;   // in bytes.
-
-static GtkWidget *toplevel, *drawable;
-
-struct parts_t *focused_parts;
-
-static GtkIMContext *im_context;
-
-struct {
-    gchar *str;
-    PangoAttrList *attrs;
-    gint pos;
-} preedit;
-
-static char *insert_string(const char *orig, int pos, const char *str);
-
 static void make_handle_geoms(struct parts_t *p, struct handle_t *bufp)
 {
     struct handle_t *bp = bufp;
@@ -97,7 +90,7 @@ static void make_handle_geoms(struct parts_t *p, struct handle_t *bufp)
     handle_calc_geom(bufp, HANDLE_NR);
 }
 
-static int cursor_next_pos_in_bytes(const char *text, int pos)
+int text_next_pos_in_bytes(const char *text, int pos)
 {
     glong pos_in_chars_till_pos, pos_in_chars_total;
     gunichar *uni_str_till_pos = g_utf8_to_ucs4(text, pos, NULL, &pos_in_chars_till_pos, NULL);
@@ -116,7 +109,7 @@ static int cursor_next_pos_in_bytes(const char *text, int pos)
     return new_pos;
 }
 
-static int cursor_prev_pos_in_bytes(const char *text, int pos)
+int text_prev_pos_in_bytes(const char *text, int pos)
 {
     glong pos_in_chars_till_pos, pos_in_chars_total;
     gunichar *uni_str_till_pos = g_utf8_to_ucs4(text, pos, NULL, &pos_in_chars_till_pos, NULL);
@@ -183,42 +176,150 @@ static PangoLayout *make_outline(PangoLayout *layout, int cursor_pos)
     
     if (cursor_pos >= 0) {
 	/* don't draw outline at the cursored char. */
-	int cursor_next = cursor_next_pos_in_bytes(pango_layout_get_text(layout), cursor_pos);
+	int cursor_next = text_next_pos_in_bytes(pango_layout_get_text(layout), cursor_pos);
 	set_forealpha(attr_list, cursor_pos, cursor_next, 0);
     }
     
     return layout;
 }
 
-void text_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
+static PangoLayout *create_layout(struct render_ctx_t *ctx, struct parts_t *parts, const char *text)
 {
-    gchar *text = g_strdup(parts->text);
-    
-    PangoLayout *layout = gtk_widget_create_pango_layout(drawable, text);
+    PangoLayout *layout = pango_layout_new(ctx->pango);
+    pango_layout_set_text(layout, text, -1);
     pango_layout_set_width(layout, parts->width * PANGO_SCALE);
     
     PangoFontDescription *font_desc = pango_font_description_from_string(parts->fontname);
     pango_layout_set_font_description(layout, font_desc);
     pango_font_description_free(font_desc);
     
+    return layout;
+}
+
+static char *insert_string(const char *orig, int pos, const char *str)
+{
+    return g_strdup_printf("%.*s%s%s", pos, orig, str, orig + pos);
+}
+
+/* the layout of the text as shown, with the preedit string inserted.
+ * the cursor position in it is returned to *cursoring_pos_ret.
+ */
+static PangoLayout *make_layout(struct render_ctx_t *ctx, struct parts_t *parts, int *cursoring_pos_ret)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    gchar *text = g_strdup(parts->text);
+    
+    PangoLayout *layout = create_layout(ctx, parts, text);
+    
     PangoAttrList *attr_list = pango_attr_list_new();
     // +1 for preedit str coloring at the end of text.
     set_forecolor(attr_list, 0, strlen(text) + 1, parts->fg.red, parts->fg.green, parts->fg.blue);
     
-    int cursoring_pos = cursor_pos;
+    int cursoring_pos = focus->cursor_pos;
     
-    if (parts == focused_parts && preedit.attrs != NULL) {
-	if (strlen(preedit.str) != 0) {
-	    pango_attr_list_splice(attr_list, preedit.attrs, cursoring_pos, strlen(preedit.str));
-	    gchar *str = insert_string(text, cursoring_pos, preedit.str);
+    if (parts == focus->parts && focus->preedit_attrs != NULL) {
+	if (strlen(focus->preedit_str) != 0) {
+	    pango_attr_list_splice(attr_list, focus->preedit_attrs, cursoring_pos, strlen(focus->preedit_str));
+	    gchar *str = insert_string(text, cursoring_pos, focus->preedit_str);
 	    g_free(text);
 	    text = str;
 	    pango_layout_set_text(layout, text, strlen(text));
-	    cursoring_pos += strlen(preedit.str);
+	    cursoring_pos += strlen(focus->preedit_str);
 	}
     }
     
     pango_layout_set_attributes(layout, attr_list);
+    pango_attr_list_unref(attr_list);
+    g_free(text);
+    
+    if (cursoring_pos_ret != NULL)
+	*cursoring_pos_ret = cursoring_pos;
+    return layout;
+}
+
+/* rendered sprites of a text part. it is shared by the copies of the part
+ * in the history, and is rebuilt only when the key changes.
+ */
+struct text_cache_t {
+    int ref_count;
+    
+    /* key */
+    char *text;
+    const char *fontname;	/* interned */
+    GdkRGBA fg;
+    int width;
+    int cursor_pos;		/* -1 if not focused. */
+    unsigned int preedit_serial;
+    
+    /* value */
+    int layout_width, layout_height;
+    PangoRectangle cursor_rect;
+    int sprite_width, sprite_height;
+    cairo_surface_t *text_sprite, *outline_sprite;
+    cairo_surface_t *shadow_sprite;	/* A8 */
+    int shadow_x, shadow_y;	/* offset of the shadow from the other sprites */
+};
+
+void text_cache_ref(struct text_cache_t *cache)
+{
+    g_atomic_int_inc(&cache->ref_count);
+}
+
+void text_cache_unref(struct text_cache_t *cache)
+{
+    if (!g_atomic_int_dec_and_test(&cache->ref_count))
+	return;
+    cairo_surface_destroy(cache->shadow_sprite);
+    cairo_surface_destroy(cache->outline_sprite);
+    cairo_surface_destroy(cache->text_sprite);
+    g_free(cache->text);
+    g_free(cache);
+}
+
+static size_t surface_size(cairo_surface_t *sf)
+{
+    if (sf == NULL)
+	return 0;
+    return (size_t) cairo_image_surface_get_stride(sf) * cairo_image_surface_get_height(sf);
+}
+
+/* the memory the sprites take, roughly. */
+size_t text_cache_size(struct text_cache_t *cache)
+{
+    return sizeof *cache
+	    + surface_size(cache->text_sprite)
+	    + surface_size(cache->outline_sprite)
+	    + surface_size(cache->shadow_sprite);
+}
+
+static gboolean text_cache_is_valid(struct render_ctx_t *ctx, struct text_cache_t *cache, struct parts_t *parts)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    int cursor = parts == focus->parts ? focus->cursor_pos : -1;
+    unsigned int serial = parts == focus->parts ? focus->preedit_serial : 0;
+    
+    return cache->cursor_pos == cursor
+	    && cache->preedit_serial == serial
+	    && cache->width == parts->width
+	    && gdk_rgba_equal(&cache->fg, &parts->fg)
+	    && g_strcmp0(cache->text, parts->text) == 0
+	    && cache->fontname == parts->fontname;
+}
+
+static struct text_cache_t *text_cache_build(struct render_ctx_t *ctx, struct parts_t *parts)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    struct text_cache_t *cache = g_new0(struct text_cache_t, 1);
+    cache->ref_count = 1;
+    cache->text = g_strdup(parts->text);
+    cache->fontname = parts->fontname;
+    cache->fg = parts->fg;
+    cache->width = parts->width;
+    cache->cursor_pos = parts == focus->parts ? focus->cursor_pos : -1;
+    cache->preedit_serial = parts == focus->parts ? focus->preedit_serial : 0;
+    
+    int cursoring_pos;
+    PangoLayout *layout = make_layout(ctx, parts, &cursoring_pos);
     
     PangoRectangle cursor_rect = {
 	.x = 0,
@@ -226,7 +327,7 @@ void text_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
 	.width = 0,
 	.height = 0,
     };
-    if (parts == focused_parts) {
+    if (parts == focus->parts) {
 	pango_layout_index_to_pos(layout, cursoring_pos, &cursor_rect);
 	cursor_rect.x /= PANGO_SCALE;
 	cursor_rect.y /= PANGO_SCALE;
@@ -244,30 +345,26 @@ void text_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
 	    cursor_rect.width = 1;
     } else
 	cursoring_pos = -1;
+    cache->cursor_rect = cursor_rect;
     
     PangoLayout *layout_outline = make_outline(layout, cursoring_pos);
     
-#define DIFF 4.0
-#define PADDING 32
-    
     int width, height;
     pango_layout_get_size(layout, &width, &height);
     width /= PANGO_SCALE;
     height /= PANGO_SCALE;
-    if (parts->width < width)
-	parts->width = width;
-    if (parts->height < height)
-	parts->height = height;
+    cache->layout_width = width;
+    cache->layout_height = height;
     width += PADDING * 2;
     height += PADDING * 2;
+    cache->sprite_width = width;
+    cache->sprite_height = height;
     int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
     
-    cairo_matrix_t mat;
     
     /* make text */
     
-    unsigned char *data0 = g_malloc0(stride * height);
-    cairo_surface_t *sf0 = cairo_image_surface_create_for_data(data0, CAIRO_FORMAT_ARGB32, width, height, stride);
+    cairo_surface_t *sf0 = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
     cairo_t *cr0 = cairo_create(sf0);
     
     cairo_save(cr0);
@@ -276,158 +373,113 @@ void text_draw(struct parts_t *parts, cairo_t *cr, gboolean selected)
     cairo_restore(cr0);
     cairo_surface_flush(sf0);
     
-    cairo_pattern_t *pat0 = cairo_pattern_create_for_surface(sf0);
-    
     /* make outline */
     
-    unsigned char *data1 = g_malloc0(stride * height);
-    cairo_surface_t *sf1 = cairo_image_surface_create_for_data(data1, CAIRO_FORMAT_ARGB32, width, height, stride);
-    cairo_t *cr1 = cairo_create(sf1);
-    
-    for (int i = 0; i < TCOS_NR; i++) {
-	int dx = DIFF * tcos(i);
-	int dy = DIFF * tsin(i);
-	cairo_matrix_init_identity(&mat);
-	cairo_matrix_translate(&mat, -dx, -dy);
-	cairo_pattern_set_matrix(pat0, &mat);
-	
-	cairo_save(cr1);
-	cairo_set_source(cr1, pat0);
-	cairo_rectangle(cr1, 0, 0, width, height);
-	cairo_fill(cr1);
-	cairo_restore(cr1);
-    }
-    
-    cairo_matrix_init_identity(&mat);
-    cairo_pattern_set_matrix(pat0, &mat);
+    cairo_surface_t *sf1 = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    unsigned char *data1 = cairo_image_surface_get_data(sf1);
+    filter_dilate_alpha(cairo_image_surface_get_data(sf0), cairo_image_surface_get_stride(sf0),
+	    data1, stride, width, height, DIFF);
+    cairo_surface_mark_dirty(sf1);
     
-    cairo_save(cr1);
-    cairo_set_source(cr1, pat0);
-    cairo_rectangle(cr1, 0, 0, width, height);
-    cairo_fill(cr1);
-    cairo_restore(cr1);
-    
-    cairo_surface_flush(sf1);
+    /* make shadow */
     
-    for (int y = 0; y < height; y++) {
-	uint32_t *p = (uint32_t *) (data1 + stride * y);
-	for (int x = 0; x < width; x++) {
-	    uint32_t argb = *p;
-	    unsigned int a = argb >> 24;
-	    argb = a << 24 | a << 16 | a << 8 | a;	// alpha'ed white
-	    *p++ = argb;
-	}
-    }
+    int shadow_x, shadow_y;
+    cairo_surface_t *sf2 = shadow_make_sprite(&shadow_default, sf1, &shadow_x, &shadow_y);
     
-    cairo_pattern_t *pat1 = cairo_pattern_create_for_surface(sf1);
+    cache->text_sprite = sf0;
+    cache->outline_sprite = sf1;
+    cache->shadow_sprite = sf2;
+    cache->shadow_x = shadow_x;
+    cache->shadow_y = shadow_y;
     
-    /* make shadow */
+    cairo_destroy(cr0);
+    g_object_unref(layout_outline);
+    g_object_unref(layout);
     
-    static gboolean alpha_div_20_inited = FALSE;
-    static unsigned char alpha_div_20[256];
-    if (!alpha_div_20_inited) {
-	alpha_div_20_inited = TRUE;
-	for (int i = 0; i < 256; i++)
-	    alpha_div_20[i] = i / 20;
+    return cache;
+}
+
+static struct text_cache_t *text_cache_get(struct render_ctx_t *ctx, struct parts_t *parts)
+{
+    if (parts->text_cache != NULL && !text_cache_is_valid(ctx, parts->text_cache, parts)) {
+	text_cache_unref(parts->text_cache);
+	parts->text_cache = NULL;
     }
-    unsigned char *data2 = g_malloc0(stride * height);
-    for (int y = 0; y < height; y++) {
-	uint32_t *sp = (uint32_t *) (data1 + stride * y);
-	uint32_t *dp = (uint32_t *) (data2 + stride * y);
-	for (int x = 0; x < width; x++) {
-	    uint32_t argb = *sp++;
-	    unsigned int a = argb >> 24;
-	    *dp++ = alpha_div_20[a] << 24;	/* * 0.05, black */
-	}
+    if (parts->text_cache == NULL)
+	parts->text_cache = text_cache_build(ctx, parts);
+    return parts->text_cache;
+}
+
+static void paint_sprite(cairo_t *cr, cairo_surface_t *sprite, double x, double y)
+{
+    cairo_save(cr);
+    cairo_set_source_surface(cr, sprite, x, y);
+    cairo_rectangle(cr, x, y,
+	    cairo_image_surface_get_width(sprite), cairo_image_surface_get_height(sprite));
+    cairo_fill(cr);
+    cairo_restore(cr);
+}
+
+/* builds the sprites, which uses pango and so is done on the main thread
+ * only, and fits the size to the text, so that drawing doesn't change
+ * anything.
+ */
+void text_prepare(struct render_ctx_t *ctx, struct parts_t *parts)
+{
+    struct text_cache_t *cache = text_cache_get(ctx, parts);
+    
+    if (parts->width < cache->layout_width) {
+	parts->width = cache->layout_width;
+	/* the cache is for the width, so build it again. */
+	cache = text_cache_get(ctx, parts);
     }
+    if (parts->height < cache->layout_height)
+	parts->height = cache->layout_height;
+}
+
+/* draws the sprites text_prepare() built. this may be on any thread,
+ * so nothing is built here.
+ */
+void text_draw(struct render_ctx_t *ctx, struct parts_t *parts, cairo_t *cr, gboolean selected)
+{
+    struct text_cache_t *cache = parts->text_cache;
+    if (cache == NULL)
+	return;
+    PangoRectangle *cursor_rect = &cache->cursor_rect;
     
-    cairo_surface_t *sf2 = cairo_image_surface_create_for_data(data2, CAIRO_FORMAT_ARGB32, width, height, stride);
-    cairo_pattern_t *pat2 = cairo_pattern_create_for_surface(sf2);
+    int x = parts->x - PADDING;
+    int y = parts->y - PADDING;
     
     /* draw outline shadow */
     
-    for (int i = 0; i < TCOS_NR; i++) {
-	int dx = DIFF * tcos(i) + DIFF / 2;
-	int dy = DIFF * tsin(i) + DIFF / 2;
-	
-	cairo_matrix_init_identity(&mat);
-	cairo_matrix_translate(&mat, -(parts->x + dx - PADDING), -(parts->y + dy - PADDING));
-	cairo_pattern_set_matrix(pat2, &mat);
-	
-	cairo_save(cr);
-	cairo_set_source(cr, pat2);
-	cairo_rectangle(cr, parts->x + dx - PADDING, parts->y + dy - PADDING, width, height);
-	cairo_fill(cr);
-	cairo_restore(cr);
-    }
+    shadow_draw_sprite(cr, &shadow_default, cache->shadow_sprite,
+	    x + cache->shadow_x, y + cache->shadow_y);
     
     /* draw cursor shadow */
     
-    for (int i = 0; i < TCOS_NR; i++) {
-	int dx = DIFF * tcos(i) + DIFF / 2;
-	int dy = DIFF * tsin(i) + DIFF / 2;
-	
-	cairo_save(cr);
-	cairo_set_source_rgba(cr, 1, 1, 1, 0.05);
-	cairo_rectangle(cr,
-		parts->x + cursor_rect.x + dx, parts->y + cursor_rect.y + dy,
-		cursor_rect.width, cursor_rect.height);
-	cairo_fill(cr);
-	cairo_restore(cr);
+    if (cursor_rect->width > 0) {
+	shadow_draw_rect(cr, &cursor_shadow,
+		parts->x + cursor_rect->x, parts->y + cursor_rect->y,
+		cursor_rect->width, cursor_rect->height);
     }
     
     /* draw outline */
     
-    cairo_matrix_init_identity(&mat);
-    cairo_matrix_translate(&mat, -(parts->x - PADDING), -(parts->y - PADDING));
-    cairo_pattern_set_matrix(pat1, &mat);
-    
-    cairo_save(cr);
-    cairo_set_source(cr, pat1);
-    cairo_rectangle(cr, parts->x - PADDING, parts->y - PADDING, width, height);
-    cairo_fill(cr);
-    cairo_restore(cr);
+    paint_sprite(cr, cache->outline_sprite, x, y);
     
     /* draw cursor */
     
     cairo_save(cr);
     cairo_set_source_rgba(cr, 0, 0, 0, 1);
     cairo_rectangle(cr,
-	    parts->x + cursor_rect.x, parts->y + cursor_rect.y,
-	    cursor_rect.width, cursor_rect.height);
+	    parts->x + cursor_rect->x, parts->y + cursor_rect->y,
+	    cursor_rect->width, cursor_rect->height);
     cairo_fill(cr);
     cairo_restore(cr);
     
     /* draw text */
     
-    cairo_matrix_init_identity(&mat);
-    cairo_matrix_translate(&mat, -(parts->x - PADDING), -(parts->y - PADDING));
-    cairo_pattern_set_matrix(pat0, &mat);
-    
-    cairo_save(cr);
-    cairo_set_source(cr, pat0);
-    cairo_rectangle(cr, parts->x - PADDING, parts->y - PADDING, width, height);
-    cairo_fill(cr);
-    cairo_restore(cr);
-    
-#undef PADDING
-#undef DIFF
-    
-    cairo_pattern_destroy(pat2);
-    cairo_pattern_destroy(pat1);
-    cairo_pattern_destroy(pat0);
-    cairo_surface_destroy(sf2);
-    g_free(data2);
-    cairo_destroy(cr1);
-    cairo_surface_destroy(sf1);
-    g_free(data1);
-    cairo_destroy(cr0);
-    cairo_surface_destroy(sf0);
-    g_free(data0);
-    g_object_unref(layout_outline);
-    pango_attr_list_unref(attr_list);
-    g_object_unref(layout);
-    g_free(text);
+    paint_sprite(cr, cache->text_sprite, x, y);
 }
 
 void text_draw_handle(struct parts_t *parts, cairo_t *cr)
@@ -437,7 +489,7 @@ void text_draw_handle(struct parts_t *parts, cairo_t *cr)
     handle_draw(handles, HANDLE_NR, cr);
 }
 
-gboolean text_select(struct parts_t *parts, int x, int y, gboolean selected)
+gboolean text_select(struct parts_t *parts, struct drag_t *drag, int x, int y, gboolean selected)
 {
     struct handle_t handles[HANDLE_NR];
     make_handle_geoms(parts, handles);
@@ -446,13 +498,13 @@ gboolean text_select(struct parts_t *parts, int x, int y, gboolean selected)
 	for (int i = 0; i < HANDLE_NR; i++) {
 	    if (x >= handles[i].x && x < handles[i].x + handles[i].width
 		    && y >= handles[i].y && y < handles[i].y + handles[i].height) {
-		beg_x = x;
-		beg_y = y;
-		orig_x = parts->x;
-		orig_y = parts->y;
-		orig_w = parts->width;
-		orig_h = parts->height;
-		dragging_handle = i;
+		drag->beg_x = x;
+		drag->beg_y = y;
+		drag->orig_x = parts->x;
+		drag->orig_y = parts->y;
+		drag->orig_w = parts->width;
+		drag->orig_h = parts->height;
+		drag->handle = i;
 		return TRUE;
 	    }
 	}
@@ -476,259 +528,102 @@ gboolean text_select(struct parts_t *parts, int x, int y, gboolean selected)
 	y2 = t;
     }
     
-    beg_x = x;
-    beg_y = y;
-    orig_x = parts->x;
-    orig_y = parts->y;
-    dragging_handle = -1;
+    drag->beg_x = x;
+    drag->beg_y = y;
+    drag->orig_x = parts->x;
+    drag->orig_y = parts->y;
+    drag->handle = -1;
     
     if (x >= x1 && x < x2 && y >= y1 && y < y2)
 	return TRUE;
     return FALSE;
 }
 
-void text_drag_step(struct parts_t *p, int x, int y)
+void text_drag_step(struct parts_t *p, struct drag_t *drag, int x, int y)
 {
-    int dx = x - beg_x;
-    int dy = y - beg_y;
+    int dx = x - drag->beg_x;
+    int dy = y - drag->beg_y;
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_LEFT:
     case HANDLE_LEFT:
     case HANDLE_BOTTOM_LEFT:
-	p->x = orig_x + dx;
-	p->width = orig_w - dx;
+	p->x = drag->orig_x + dx;
+	p->width = drag->orig_w - dx;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_RIGHT:
     case HANDLE_RIGHT:
     case HANDLE_BOTTOM_RIGHT:
-	p->width = orig_w + dx;
+	p->width = drag->orig_w + dx;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_TOP_LEFT:
     case HANDLE_TOP:
     case HANDLE_TOP_RIGHT:
-	p->y = orig_y + dy;
-	p->height = orig_h - dy;
+	p->y = drag->orig_y + dy;
+	p->height = drag->orig_h - dy;
     }
     
-    switch (dragging_handle) {
+    switch (drag->handle) {
     case HANDLE_BOTTOM_LEFT:
     case HANDLE_BOTTOM:
     case HANDLE_BOTTOM_RIGHT:
-	p->height = orig_h + dy;
+	p->height = drag->orig_h + dy;
     }
     
-    if (dragging_handle == -1) {
-	p->x = orig_x + dx;
-	p->y = orig_y + dy;
+    if (drag->handle == -1) {
+	p->x = drag->orig_x + dx;
+	p->y = drag->orig_y + dy;
     }
 }
 
-void text_drag_fini(struct parts_t *parts, int x, int y)
+void text_drag_fini(struct parts_t *parts, struct drag_t *drag, int x, int y)
 {
 }
 
-struct parts_t *text_create(int x, int y)
+void text_get_bbox(struct parts_t *parts, cairo_rectangle_int_t *rect)
 {
-    struct parts_t *p = parts_alloc();
+    /* the text is measured when the part is prepared. */
+    struct text_cache_t *cache = parts->text_cache;
+    int width = cache != NULL ? cache->layout_width : parts->width;
+    int height = cache != NULL ? cache->layout_height : parts->height;
     
-    p->type = PARTS_TEXT;
-    p->x = x;
-    p->y = y;
-    p->width = 200;
-    p->height = 100;
-    p->text = g_strdup("");
+    cairo_rectangle_int_t r = { parts->x, parts->y, width, height };
+    /* the sprites are PADDING larger than the text, and the shadow sticks out of them. */
+    bbox_inflate(&r, PADDING + shadow_extent(&shadow_default));
     
-    return p;
-}
-
-static char *insert_string(const char *orig, int pos, const char *str)
-{
-    return g_strdup_printf("%.*s%s%s", cursor_pos, orig, str, orig + pos);
-}
-
-static void insert_string_at_cursor(struct parts_t *parts, const char *str)
-{
-    gchar *new_str = insert_string(parts->text, cursor_pos, str);
-    if (parts->text != NULL)
-	g_free(parts->text);
-    parts->text = new_str;
-    cursor_pos += strlen(str);
+    bbox_from_corners(rect, parts->x, parts->y, parts->x + parts->width, parts->y + parts->height);
+    bbox_union(rect, &r);
 }
 
-void text_focus(struct parts_t *parts, int x, int y)
+/* the byte index in the text at (x, y), or the end of the text if there
+ * is nothing there.
+ */
+int text_index_at(struct render_ctx_t *ctx, struct parts_t *parts, int x, int y)
 {
-    PangoLayout *layout = gtk_widget_create_pango_layout(drawable, parts->text);
-    pango_layout_set_width(layout, parts->width * PANGO_SCALE);
-    
-    PangoFontDescription *font_desc = pango_font_description_from_string(parts->fontname);
-    pango_layout_set_font_description(layout, font_desc);
-    pango_font_description_free(font_desc);
+    int index, trail;
+    PangoLayout *layout = create_layout(ctx, parts, parts->text);
     
-    int new_cursor_pos, trail;
-    if (pango_layout_xy_to_index(layout, (x - parts->x) * PANGO_SCALE, (y - parts->y) * PANGO_SCALE, &new_cursor_pos, &trail)) {
-	cursor_pos = new_cursor_pos;
-	focused_parts = parts;
-	gtk_widget_queue_draw(drawable);
-    } else {
-	cursor_pos = strlen(parts->text);
-	focused_parts = parts;
-	gtk_widget_queue_draw(drawable);
-    }
+    if (!pango_layout_xy_to_index(layout, (x - parts->x) * PANGO_SCALE, (y - parts->y) * PANGO_SCALE, &index, &trail))
+	index = strlen(parts->text);
     
     g_object_unref(layout);
+    return index;
 }
 
-void text_unfocus(void)
-{
-    focused_parts = NULL;
-}
-
-gboolean text_has_focus(void)
+struct parts_t *text_create(struct render_ctx_t *ctx, int x, int y)
 {
-    return focused_parts != NULL;
-}
-
-gboolean text_filter_keypress(GdkEventKey *ev)
-{
-    if (im_context != NULL) {
-	if (gtk_im_context_filter_keypress (im_context, ev))
-	    return TRUE;
-	if (focused_parts != NULL) {
-	    if (ev->keyval == GDK_KEY_Right) {
-		int cursor_next = cursor_next_pos_in_bytes(focused_parts->text, cursor_pos);
-		cursor_pos = cursor_next;
-		gtk_widget_queue_draw(drawable);
-		return TRUE;
-	    }
-	    if (ev->keyval == GDK_KEY_Left) {
-		int cursor_next = cursor_prev_pos_in_bytes(focused_parts->text, cursor_pos);
-		cursor_pos = cursor_next;
-		gtk_widget_queue_draw(drawable);
-		return TRUE;
-	    }
-	    if (ev->keyval == GDK_KEY_BackSpace) {
-		int new_pos = cursor_prev_pos_in_bytes(focused_parts->text, cursor_pos);
-		if (new_pos < cursor_pos) {
-		    gchar *new_str = g_strdup_printf("%.*s%s",
-			    new_pos, focused_parts->text,
-			    focused_parts->text + cursor_pos);
-		    g_free(focused_parts->text);
-		    focused_parts->text = new_str;
-		    cursor_pos = new_pos;
-		    gtk_widget_queue_draw(drawable);
-		    return TRUE;
-		}
-	    }
-	    if (ev->keyval == GDK_KEY_Return) {
-		insert_string_at_cursor(focused_parts, "\n");
-		gtk_widget_queue_draw(drawable);
-		return TRUE;
-	    }
-	}
-    }
-    return FALSE;
-}
-
-static void im_context_commit_cb(GtkIMContext *imc, gchar *str, gpointer user_data)
-{
-    if (im_context == NULL)
-	return;
-    if (focused_parts == NULL)
-	return;
-    if (cursor_pos >= strlen(focused_parts->text))
-	cursor_pos = strlen(focused_parts->text);
-    if (cursor_pos < 0)
-	cursor_pos = 0;
-    insert_string_at_cursor(focused_parts, str);
+    struct parts_t *p = parts_alloc(ctx);
     
-    gtk_widget_queue_draw(drawable);
-}
-
-static gboolean im_context_retrieve_surrounding_cb(GtkIMContext *imc, gpointer user_data)
-{
-    gtk_im_context_set_surrounding(imc, "", -1, 0);
-    return TRUE;
-}
-
-static gboolean im_context_delete_surrounding_cb(GtkIMContext *imc, int offset, int n_chars, gpointer user_data)
-{
-    return TRUE;
-}
-
-static void im_context_preedit_changed_cb(GtkIMContext *imc, gpointer user_data)
-{
-    char *str;
-    PangoAttrList *attrs;
-    int pos;
-    
-    if (im_context == NULL)
-	return;
-    
-    gtk_im_context_get_preedit_string(imc, &str, &attrs, &pos);
-    
-    if (preedit.str != NULL)
-	g_free(preedit.str);
-    if (preedit.attrs != NULL)
-	pango_attr_list_unref(preedit.attrs);
-    preedit.str = str;
-    preedit.attrs = attrs;
-
-    gtk_widget_queue_draw(drawable);
-}
-
-static void im_context_preedit_end_cb(GtkIMContext *imc, gpointer user_data)
-{
-    if (im_context == NULL)
-	return;
+    p->type = PARTS_TEXT;
+    p->x = x;
+    p->y = y;
+    p->width = 200;
+    p->height = 100;
+    p->text = g_strdup("");
     
-    if (preedit.str != NULL)
-	g_free(preedit.str);
-    if (preedit.attrs != NULL)
-	pango_attr_list_unref(preedit.attrs);
-    preedit.str = NULL;
-    preedit.attrs = NULL;
-}
-
-static void im_context_preedit_start_cb(GtkIMContext *imc, gpointer user_data)
-{
-}
-
-void text_focus_in(void)
-{
-    if (im_context != NULL) {
-	gtk_im_context_reset (im_context);
-	gtk_im_context_set_client_window (im_context, gtk_widget_get_window (toplevel));
-	gtk_im_context_focus_in (im_context);
-    }
-}
-
-void text_focus_out(void)
-{
-    if (im_context != NULL) {
-	gtk_im_context_reset (im_context);
-	gtk_im_context_focus_out (im_context);
-	gtk_im_context_set_client_window (im_context, NULL);
-    }
-}
-
-void text_init(GtkWidget *top, GtkWidget *w)
-{
-    toplevel = top;
-    drawable = w;
-    
-    im_context = gtk_im_multicontext_new();
-    g_signal_connect(im_context, "commit", G_CALLBACK(im_context_commit_cb), NULL);
-    g_signal_connect(im_context, "retrieve-surrounding", G_CALLBACK(im_context_retrieve_surrounding_cb), NULL);
-    g_signal_connect(im_context, "delete-surrounding", G_CALLBACK(im_context_delete_surrounding_cb), NULL);
-    g_signal_connect(im_context, "preedit-changed", G_CALLBACK(im_context_preedit_changed_cb), NULL);
-    g_signal_connect(im_context, "preedit-end", G_CALLBACK(im_context_preedit_end_cb), NULL);
-    g_signal_connect(im_context, "preedit-start", G_CALLBACK(im_context_preedit_start_cb), NULL);
-    gtk_im_context_set_use_preedit (im_context, TRUE);
-
-    text_focus_in();
+    return p;
 }
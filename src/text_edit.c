@@ -0,0 +1,231 @@
+/*    gpicann - Screenshot Annotation Tool
+ *    Copyright (C) 2020 Yuuki Harano
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <gtk/gtk.h>
+
+#include "common.h"
+#include "main.h"
+#include "shapes.h"
+
+/* editing text in the window. the text being edited is in the focus of
+ * the render context, where text_draw() finds the cursor and the preedit
+ * string.
+ */
+
+static GtkWidget *toplevel;
+static struct render_ctx_t *ctx;
+
+static GtkIMContext *im_context;
+
+static void insert_string_at_cursor(struct parts_t *parts, const char *str)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    parts = history_writable_parts(doc->hp, parts);
+    gchar *new_str = g_strdup_printf("%.*s%s%s", focus->cursor_pos, parts->text, str, parts->text + focus->cursor_pos);
+    if (parts->text != NULL)
+	g_free(parts->text);
+    parts->text = new_str;
+    focus->cursor_pos += strlen(str);
+}
+
+void text_focus(struct parts_t *parts, int x, int y)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    
+    damage_add_parts(focus->parts);
+    
+    focus->cursor_pos = text_index_at(ctx, parts, x, y);
+    focus->parts = parts;
+    damage_add_parts(parts);
+}
+
+void text_unfocus(void)
+{
+    damage_add_parts(ctx->focus.parts);
+    ctx->focus.parts = NULL;
+}
+
+gboolean text_has_focus(void)
+{
+    return ctx->focus.parts != NULL;
+}
+
+gboolean text_filter_keypress(GdkEventKey *ev)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    
+    if (im_context != NULL) {
+	if (gtk_im_context_filter_keypress (im_context, ev))
+	    return TRUE;
+	if (focus->parts != NULL) {
+	    if (ev->keyval == GDK_KEY_Right) {
+		int cursor_next = text_next_pos_in_bytes(focus->parts->text, focus->cursor_pos);
+		focus->cursor_pos = cursor_next;
+		damage_add_parts(focus->parts);
+		damage_flush();
+		return TRUE;
+	    }
+	    if (ev->keyval == GDK_KEY_Left) {
+		int cursor_next = text_prev_pos_in_bytes(focus->parts->text, focus->cursor_pos);
+		focus->cursor_pos = cursor_next;
+		damage_add_parts(focus->parts);
+		damage_flush();
+		return TRUE;
+	    }
+	    if (ev->keyval == GDK_KEY_BackSpace) {
+		int new_pos = text_prev_pos_in_bytes(focus->parts->text, focus->cursor_pos);
+		if (new_pos < focus->cursor_pos) {
+		    damage_add_parts(focus->parts);
+		    struct parts_t *parts = history_writable_parts(doc->hp, focus->parts);
+		    gchar *new_str = g_strdup_printf("%.*s%s",
+			    new_pos, parts->text,
+			    parts->text + focus->cursor_pos);
+		    g_free(parts->text);
+		    parts->text = new_str;
+		    focus->cursor_pos = new_pos;
+		    damage_add_parts(parts);
+		    damage_flush();
+		    return TRUE;
+		}
+	    }
+	    if (ev->keyval == GDK_KEY_Return) {
+		damage_add_parts(focus->parts);
+		insert_string_at_cursor(focus->parts, "\n");
+		damage_add_parts(focus->parts);
+		damage_flush();
+		return TRUE;
+	    }
+	}
+    }
+    return FALSE;
+}
+
+static void im_context_commit_cb(GtkIMContext *imc, gchar *str, gpointer user_data)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    
+    if (im_context == NULL)
+	return;
+    if (focus->parts == NULL)
+	return;
+    if (focus->cursor_pos >= strlen(focus->parts->text))
+	focus->cursor_pos = strlen(focus->parts->text);
+    if (focus->cursor_pos < 0)
+	focus->cursor_pos = 0;
+    damage_add_parts(focus->parts);
+    insert_string_at_cursor(focus->parts, str);
+    
+    damage_add_parts(focus->parts);
+    damage_flush();
+}
+
+static gboolean im_context_retrieve_surrounding_cb(GtkIMContext *imc, gpointer user_data)
+{
+    gtk_im_context_set_surrounding(imc, "", -1, 0);
+    return TRUE;
+}
+
+static gboolean im_context_delete_surrounding_cb(GtkIMContext *imc, int offset, int n_chars, gpointer user_data)
+{
+    return TRUE;
+}
+
+static void im_context_preedit_changed_cb(GtkIMContext *imc, gpointer user_data)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    char *str;
+    PangoAttrList *attrs;
+    int pos;
+    
+    if (im_context == NULL)
+	return;
+    
+    gtk_im_context_get_preedit_string(imc, &str, &attrs, &pos);
+    
+    damage_add_parts(focus->parts);
+    
+    if (focus->preedit_str != NULL)
+	g_free(focus->preedit_str);
+    if (focus->preedit_attrs != NULL)
+	pango_attr_list_unref(focus->preedit_attrs);
+    focus->preedit_str = str;
+    focus->preedit_attrs = attrs;
+    focus->preedit_serial++;
+
+    damage_add_parts(focus->parts);
+    damage_flush();
+}
+
+static void im_context_preedit_end_cb(GtkIMContext *imc, gpointer user_data)
+{
+    struct text_focus_t *focus = &ctx->focus;
+    
+    if (im_context == NULL)
+	return;
+    
+    damage_add_parts(focus->parts);
+    
+    if (focus->preedit_str != NULL)
+	g_free(focus->preedit_str);
+    if (focus->preedit_attrs != NULL)
+	pango_attr_list_unref(focus->preedit_attrs);
+    focus->preedit_str = NULL;
+    focus->preedit_attrs = NULL;
+    focus->preedit_serial++;
+    
+    damage_flush();
+}
+
+static void im_context_preedit_start_cb(GtkIMContext *imc, gpointer user_data)
+{
+}
+
+void text_focus_in(void)
+{
+    if (im_context != NULL) {
+	gtk_im_context_reset (im_context);
+	gtk_im_context_set_client_window (im_context, gtk_widget_get_window (toplevel));
+	gtk_im_context_focus_in (im_context);
+    }
+}
+
+void text_focus_out(void)
+{
+    if (im_context != NULL) {
+	gtk_im_context_reset (im_context);
+	gtk_im_context_focus_out (im_context);
+	gtk_im_context_set_client_window (im_context, NULL);
+    }
+}
+
+void text_init(GtkWidget *top, struct render_ctx_t *c)
+{
+    toplevel = top;
+    ctx = c;
+    
+    im_context = gtk_im_multicontext_new();
+    g_signal_connect(im_context, "commit", G_CALLBACK(im_context_commit_cb), NULL);
+    g_signal_connect(im_context, "retrieve-surrounding", G_CALLBACK(im_context_retrieve_surrounding_cb), NULL);
+    g_signal_connect(im_context, "delete-surrounding", G_CALLBACK(im_context_delete_surrounding_cb), NULL);
+    g_signal_connect(im_context, "preedit-changed", G_CALLBACK(im_context_preedit_changed_cb), NULL);
+    g_signal_connect(im_context, "preedit-end", G_CALLBACK(im_context_preedit_end_cb), NULL);
+    g_signal_connect(im_context, "preedit-start", G_CALLBACK(im_context_preedit_start_cb), NULL);
+    gtk_im_context_set_use_preedit (im_context, TRUE);
+
+    text_focus_in();
+}